@@ -2,6 +2,7 @@
 #include <iostream>
 #include <exception>
 #include <thread>
+#include <sstream>
 #include <absl/strings/str_format.h>
 #include <absl/strings/numbers.h>
 #include <grpcpp/grpcpp.h>
@@ -36,6 +37,11 @@ sync_t::sync_t(uint32_t whoami, uint32_t size)
     , kv_stub_(nullptr)
     , started_(false)
     , global_state_(STATE_INVALID)
+    , state_puts_(0)
+    , state_put_failures_(0)
+    , watch_responses_(0)
+    , watch_events_(0)
+    , global_state_changes_(0)
 {}
 
 void sync_t::destroy() {
@@ -160,6 +166,7 @@ void sync_t::global_state_change_check() {
     std::unique_lock<std::mutex> lck(global_state_change_mtx_);
     if (state != global_state_.load()) {
         global_state_ = state;
+        global_state_changes_++;
         global_state_change_cv_.notify_all();
         std::cout << "global state change -> " << state << std::endl;
     }
@@ -167,6 +174,8 @@ void sync_t::global_state_change_check() {
 
 void sync_t::watch_callback(::etcdserverpb::WatchResponse& response) {
     auto events = response.events();
+    watch_responses_++;
+    watch_events_ += events.size();
     for (const ::etcdserverpb::Event& event : events) {
         if (event.kv().key().rfind(conf_.key_prefix, 0) == 0) {
             const std::string& basename = event.kv().key().substr(conf_.key_prefix.size());
@@ -193,8 +202,10 @@ int sync_t::set_state(uint32_t state) {
     ::etcdserverpb::PutResponse response;
     ::grpc::ClientContext context;
     ::grpc::Status status = kv_stub_->Put(&context, request, &response);
+    state_puts_++;
 
     if (!status.ok()) {
+        state_put_failures_++;
         throw std::runtime_error(::absl::StrFormat("RPC failed: %s", status.error_message()));
     }
 
@@ -217,6 +228,34 @@ void sync_t::wait_for_global_state(int state) {
     }
 }
 
+std::string sync_t::metrics() {
+    std::stringstream ss;
+    ss << "# HELP sync_state_puts_total State updates written to etcd.\n"
+       << "# TYPE sync_state_puts_total counter\n"
+       << "sync_state_puts_total " << state_puts_ << "\n"
+       << "# HELP sync_state_put_failures_total State updates that failed.\n"
+       << "# TYPE sync_state_put_failures_total counter\n"
+       << "sync_state_put_failures_total " << state_put_failures_ << "\n"
+       << "# HELP sync_watch_responses_total Watch responses received.\n"
+       << "# TYPE sync_watch_responses_total counter\n"
+       << "sync_watch_responses_total " << watch_responses_ << "\n"
+       << "# HELP sync_watch_events_total Watch events received.\n"
+       << "# TYPE sync_watch_events_total counter\n"
+       << "sync_watch_events_total " << watch_events_ << "\n"
+       << "# HELP sync_global_state_changes_total Changes of the global state.\n"
+       << "# TYPE sync_global_state_changes_total counter\n"
+       << "sync_global_state_changes_total " << global_state_changes_ << "\n"
+       << "# HELP sync_global_state Minimum state over all processes.\n"
+       << "# TYPE sync_global_state gauge\n"
+       << "sync_global_state " << global_state_ << "\n"
+       << "# HELP sync_state Last known state of each process.\n"
+       << "# TYPE sync_state gauge\n";
+    for (uint32_t remote_id=0; remote_id<size_; remote_id++) {
+        ss << "sync_state{id=\"" << remote_id << "\"} " << state_[remote_id] << "\n";
+    }
+    return ss.str();
+}
+
 int sync_create(sync_t **S,
                 uint32_t local_id,
                 uint32_t universe_size,
@@ -311,6 +350,25 @@ int sync_wait_for_global_state(sync_t *S,
     return 0;
 }
 
+int sync_metrics(sync_t *S,
+                 char **text,
+                 char **error) {
+    std::string str = S->metrics();
+    text[0] = (char*)calloc(str.size()+1, sizeof(char));
+    if (text[0] == NULL) {
+        sync_set_error(error, ::absl::StrFormat("Unable to allocate memory."));
+        return 1;
+    }
+    memcpy(text[0], str.c_str(), str.size()+1);
+    return 0;
+}
+
+int sync_metrics_source(void *context,
+                        char **text,
+                        char **error) {
+    return sync_metrics(static_cast<sync_t*>(context), text, error);
+}
+
 int sync_destroy(sync_t *S,
                  char **error) {
     S->destroy();
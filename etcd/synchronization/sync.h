@@ -18,6 +18,13 @@ int sync_get_state(sync_t *S, int remote_id, char **error);
 
 int sync_wait_for_global_state(sync_t *S, int desired_state, char **error);
 
+// Writes the sync counters in Prometheus text format to a malloc'd string.
+int sync_metrics(sync_t *S, char **text, char **error);
+
+// sync_metrics with the signature of comms_metrics_source_t, so that the
+// comms layer can serve it. The context is the sync_t.
+int sync_metrics_source(void *context, char **text, char **error);
+
 int sync_destroy(sync_t *S, char **error);
 
 #endif // __SYNC_H_
@@ -49,6 +49,7 @@ typedef struct sync_t {
     void global_state_change_check();
     void watch_callback(::etcdserverpb::WatchResponse& response);
     void wait_for_global_state(int state);
+    std::string metrics();
 
     uint32_t whoami_;
     uint32_t size_;
@@ -67,6 +68,13 @@ typedef struct sync_t {
     std::atomic<int> global_state_;
     std::condition_variable global_state_change_cv_;
     std::mutex global_state_change_mtx_;
+
+    // Counters exported through sync_metrics().
+    std::atomic<uint64_t> state_puts_;
+    std::atomic<uint64_t> state_put_failures_;
+    std::atomic<uint64_t> watch_responses_;
+    std::atomic<uint64_t> watch_events_;
+    std::atomic<uint64_t> global_state_changes_;
 } sync_t;
 
 class AsyncEtcdBase {
@@ -1,4 +1,7 @@
+#include <cstring>
+#include <random>
 #include <thread>
+#include <iostream>
 #include <grpcpp/grpcpp.h>
 #include <google/protobuf/arena.h>
 
@@ -9,29 +12,388 @@ extern "C" {
 
 EndPoint::EndPoint(comms_end_point_t *end_point,
                    size_t end_point_id,
-                   bool is_local,
-                   std::shared_ptr<moodycamel::ConcurrentQueue<comms_bundle_t,CommsBundleTraits>> deposit_queue,
+                   size_t local_id,
+                   int lane_count,
                    uint32_t arena_start_block_depth)
         : name_(end_point->name)
         , address_(end_point->address)
         , id_(end_point_id)
-        , is_local_(is_local)
-        , stub_(::comms::Comms::NewStub(::grpc::CreateChannel(end_point->address, ::grpc::InsecureChannelCredentials())))
-        , deposit_queue_(deposit_queue)
-        , arena_start_block_size_(1<<arena_start_block_depth) {
+        , local_id_(local_id)
+        , is_local_(end_point_id == local_id)
+        , next_channel_(0)
+        , channel_policy_(COMMS_CHANNEL_ROUND_ROBIN)
+        , deposit_queue_(nullptr)
+        , priority_queue_(nullptr)
+        , arena_start_block_size_(1<<arena_start_block_depth)
+        , breaker_state_(COMMS_BREAKER_CLOSED)
+        , consecutive_failures_(0)
+        , breaker_opened_at_(0)
+        , trial_in_flight_(false)
+        , latency_us_(0)
+        , success_count_(0)
+        , failure_count_(0)
+        , breaker_failure_threshold_(0)
+        , breaker_reset_timeout_(0)
+        , lane_count_(lane_count)
+        , flow_control_window_(0)
+        , flow_control_poll_interval_(0)
+        , credit_sent_(new std::atomic<uint64_t>[lane_count])
+        , credit_limit_(new std::atomic<uint64_t>[lane_count])
+        , released_(new std::atomic<uint64_t>[lane_count])
+        , last_credit_poll_(new std::atomic<int64_t>[lane_count])
+        , sequence_(new std::atomic<uint64_t>[lane_count])
+        , removed_(false)
+        , channel_users_(0)
+        , channels_released_(false)
+        , exactly_once_(false)
+        , epoch_(0)
+        , bundle_id_(0)
+        , codec_(COMMS_CODEC_NONE)
+        , codec_level_(0)
+        , codec_min_size_(0)
+        , codec_adaptive_(false) {
+    for (int lane=0; lane<lane_count; lane++) {
+        credit_sent_[lane] = 0;
+        credit_limit_[lane] = 0;
+        released_[lane] = 0;
+        last_credit_poll_[lane] = 0;
+        sequence_[lane] = 0;
+    }
+}
+
+static int64_t comms_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 void EndPoint::set_arena_start_block_size(size_t block_size) {
     arena_start_block_size_ = block_size;
 }
 
+void EndPoint::create_channels(const config_t& conf,
+                               ::grpc::ResourceQuota *quota) {
+    const size_t channel_count = conf.channel_count;
+
+    channels_.clear();
+    stubs_.clear();
+    send_methods_.clear();
+    channels_.reserve(channel_count);
+    stubs_.reserve(channel_count);
+    for (size_t index=0; index<channel_count; index++) {
+        // gRPC shares subchannels between channels with identical arguments,
+        // which would funnel every channel onto one TCP connection. A unique
+        // argument per channel and a local subchannel pool keep them apart.
+        ::grpc::ChannelArguments args;
+        conf.apply(args, quota);
+        args.SetInt("comms.channel_index", static_cast<int>(index));
+        args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+        channels_.push_back(::grpc::CreateCustomChannel(address_, ::grpc::InsecureChannelCredentials(), args));
+        stubs_.push_back(::comms::Comms::NewStub(channels_.back()));
+        send_methods_.emplace_back(new ::grpc::internal::RpcMethod("/comms.Comms/Send", ::grpc::internal::RpcMethod::NORMAL_RPC, channels_.back()));
+    }
+
+    in_flight_ = std::unique_ptr<std::atomic<size_t>[]>(new std::atomic<size_t>[channel_count]);
+    for (size_t index=0; index<channel_count; index++) {
+        in_flight_[index] = 0;
+    }
+    channel_policy_ = conf.channel_policy;
+    breaker_failure_threshold_ = conf.breaker_failure_threshold;
+    breaker_reset_timeout_ = conf.breaker_reset_timeout;
+
+    // Until the peer reports its own limit, assume it uses our window.
+    flow_control_window_ = conf.flow_control_window;
+    flow_control_poll_interval_ = conf.flow_control_poll_interval;
+    for (int lane=0; lane<lane_count_; lane++) {
+        grant_credit(lane, flow_control_window_);
+    }
+
+    codec_ = conf.bundle_codec;
+    codec_level_ = conf.bundle_codec_level;
+    codec_min_size_ = conf.bundle_codec_min_size;
+    codec_adaptive_ = conf.bundle_codec_adaptive != 0;
+
+    // The epoch only has to differ from the previous run's, so that the
+    // peer does not take the restarted ids for ones it has seen.
+    exactly_once_ = conf.exactly_once != 0;
+    if (exactly_once_) {
+        std::random_device device;
+        epoch_ = (static_cast<uint64_t>(device()) << 32) ^ device() ^ static_cast<uint64_t>(comms_now_ns());
+        epoch_ |= 1;
+        bundle_id_ = 0;
+    }
+}
+
+// Channels are only touched between enter and leave, and not at all once
+// the end point is removed.
+bool EndPoint::enter() {
+    channel_users_.fetch_add(1);
+    if (removed_) {
+        leave();
+        return false;
+    }
+    return true;
+}
+
+void EndPoint::leave() {
+    if (channel_users_.fetch_sub(1) == 1 and removed_) {
+        release_channels();
+    }
+}
+
+void EndPoint::release_channels() {
+    if (channels_released_.exchange(true)) return;
+    send_methods_.clear();
+    stubs_.clear();
+    channels_.clear();
+}
+
+bool EndPoint::acquire_channel(size_t& channel) {
+    if (not enter()) return false;
+
+    const size_t channel_count = stubs_.size();
+    channel = next_channel_.fetch_add(1, std::memory_order_relaxed) % channel_count;
+
+    if (channel_policy_ == COMMS_CHANNEL_LEAST_LOADED) {
+        // Start the scan at the round-robin choice so that ties are spread
+        // across the pool rather than piling onto the first channel.
+        size_t best_load = in_flight_[channel].load(std::memory_order_relaxed);
+        for (size_t offset=1; offset<channel_count and best_load > 0; offset++) {
+            size_t candidate = (channel + offset) % channel_count;
+            size_t load = in_flight_[candidate].load(std::memory_order_relaxed);
+            if (load < best_load) {
+                channel = candidate;
+                best_load = load;
+            }
+        }
+    }
+
+    in_flight_[channel].fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void EndPoint::release_channel(size_t channel) {
+    in_flight_[channel].fetch_sub(1, std::memory_order_relaxed);
+    leave();
+}
+
 bool EndPoint::is_local() const {
     return is_local_;
 }
 
-bool EndPoint::deposit_n(comms_bundle_t& bundle) {
+const std::string& EndPoint::name() const {
+    return name_;
+}
+
+// Closed breakers let everything through. A half open one lets a single
+// bundle through as the trial; trial is set for its caller, who must send it
+// or hand it back with end_trial. The rest fail fast until record() closes
+// or reopens the breaker.
+bool EndPoint::available(bool& trial) {
+    trial = false;
+    if (breaker_state_.load(std::memory_order_acquire) == COMMS_BREAKER_CLOSED) return true;
+    if (not probe()) return false;
+
+    bool expected = false;
+    if (trial_in_flight_.compare_exchange_strong(expected, true)) {
+        trial = true;
+        return true;
+    }
+    return breaker_state_.load(std::memory_order_acquire) == COMMS_BREAKER_CLOSED;
+}
+
+void EndPoint::end_trial() {
+    trial_in_flight_.store(false, std::memory_order_release);
+}
+
+// Returns false while the breaker is open. Once the reset timeout has
+// elapsed, an open breaker probes its peer. The probe only asks the channels
+// to reconnect and looks at their connectivity, so it never blocks, and half
+// opens the breaker if a channel is ready.
+bool EndPoint::probe() {
+    int state = breaker_state_.load(std::memory_order_acquire);
+    if (state != COMMS_BREAKER_OPEN) return true;
+
+    int64_t now = comms_now_ms();
+    int64_t opened_at = breaker_opened_at_.load(std::memory_order_relaxed);
+    if (now - opened_at < static_cast<int64_t>(breaker_reset_timeout_)) return false;
+    if (not breaker_opened_at_.compare_exchange_strong(opened_at, now)) return false;
+    if (not enter()) return false;
+
+    bool ready = false;
+    for (auto& channel : channels_) {
+        ::grpc::experimental::ChannelResetConnectionBackoff(channel.get());
+        if (channel->GetState(true) == GRPC_CHANNEL_READY) {
+            breaker_state_.store(COMMS_BREAKER_HALF_OPEN, std::memory_order_release);
+            ready = true;
+            break;
+        }
+    }
+    leave();
+    return ready;
+}
+
+void EndPoint::record(int rc,
+                      uint64_t latency_us) {
+    if (rc == COMMS_SUCCESS) {
+        // Exponentially weighted moving average with a weight of 1/8.
+        uint64_t latency = latency_us_.load(std::memory_order_relaxed);
+        latency_us_.store(latency == 0 ? latency_us : latency - latency/8 + latency_us/8, std::memory_order_relaxed);
+        success_count_.fetch_add(1, std::memory_order_relaxed);
+        consecutive_failures_.store(0, std::memory_order_relaxed);
+
+        if (breaker_state_.exchange(COMMS_BREAKER_CLOSED) != COMMS_BREAKER_CLOSED) {
+            std::cerr << "[" << name_ << "] peer recovered, closing circuit breaker" << std::endl;
+        }
+        end_trial();
+        return;
+    }
+
+    failure_count_.fetch_add(1, std::memory_order_relaxed);
+
+    // Only failures that say the peer is unreachable count against it. A
+    // peer that pushes back with RESOURCE_EXHAUSTED is alive, and the next
+    // bundle may try again.
+    if (rc != COMMS_UNAVAILABLE and rc != COMMS_DEADLINE_EXCEEDED) {
+        end_trial();
+        return;
+    }
+
+    uint32_t failures = consecutive_failures_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (breaker_failure_threshold_ == 0) return;
+
+    int state = breaker_state_.load(std::memory_order_acquire);
+    if (state == COMMS_BREAKER_HALF_OPEN or
+            (state == COMMS_BREAKER_CLOSED and failures >= breaker_failure_threshold_)) {
+        breaker_opened_at_.store(comms_now_ms(), std::memory_order_relaxed);
+        if (breaker_state_.compare_exchange_strong(state, COMMS_BREAKER_OPEN) and state == COMMS_BREAKER_CLOSED) {
+            std::cerr << "[" << name_ << "] " << failures
+                      << " consecutive failures, opening circuit breaker" << std::endl;
+        }
+    }
+    end_trial();
+}
+
+void EndPoint::health(comms_end_point_health_t *health) const {
+    health->state = static_cast<uint32_t>(breaker_state_.load(std::memory_order_acquire));
+    health->consecutive_failures = consecutive_failures_.load(std::memory_order_relaxed);
+    health->latency_us = latency_us_.load(std::memory_order_relaxed);
+    health->success_count = success_count_.load(std::memory_order_relaxed);
+    health->failure_count = failure_count_.load(std::memory_order_relaxed);
+}
+
+bool EndPoint::acquire_credit(uint32_t lane) {
+    if (flow_control_window_ == 0) return true;
+
+    uint64_t sent = credit_sent_[lane].load(std::memory_order_relaxed);
+    do {
+        if (sent >= credit_limit_[lane].load(std::memory_order_acquire)) return false;
+    } while (not credit_sent_[lane].compare_exchange_weak(sent, sent+1));
+    return true;
+}
+
+void EndPoint::refund_credit(uint32_t lane) {
+    if (flow_control_window_ == 0) return;
+    credit_sent_[lane].fetch_sub(1, std::memory_order_relaxed);
+}
+
+void EndPoint::grant_credit(uint32_t lane,
+                            uint64_t limit) {
+    // Responses may arrive out of order; the limit only ever moves forward.
+    uint64_t current = credit_limit_[lane].load(std::memory_order_relaxed);
+    while (limit > current and not credit_limit_[lane].compare_exchange_weak(current, limit));
+}
+
+void EndPoint::poll_credit(uint32_t lane,
+                           size_t deadline) {
+    // Rate limit polls so that a starved sender doesn't flood the peer. Each
+    // lane has its own limit, so a starved lane does not keep another one
+    // from polling.
+    int64_t now = comms_now_ms();
+    int64_t last_poll = last_credit_poll_[lane].load(std::memory_order_relaxed);
+    if (now - last_poll < static_cast<int64_t>(flow_control_poll_interval_)) return;
+    if (not last_credit_poll_[lane].compare_exchange_strong(last_poll, now)) return;
+
+    // An empty bundle costs no credit and carries the current limit back.
+    ::comms::PacketBundle packet_bundle;
+    packet_bundle.set_src(local_id_);
+    packet_bundle.set_lane(lane);
+
+    ::comms::PacketResponse response;
+    ::grpc::Status status = send_packets_internal(packet_bundle, response, deadline);
+    if (status.ok()) {
+        grant_credit(lane, response.credit_limit());
+    }
+}
+
+void EndPoint::release(uint32_t lane) {
+    released_[lane].fetch_add(1, std::memory_order_release);
+}
+
+uint64_t EndPoint::credit_limit(uint32_t lane) const {
+    if (flow_control_window_ == 0) return UINT64_MAX;
+    return released_[lane].load(std::memory_order_acquire) + flow_control_window_;
+}
+
+uint64_t EndPoint::next_sequence(uint32_t lane) {
+    return sequence_[lane].fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void EndPoint::remove() {
+    removed_ = true;
+    if (channel_users_ == 0) {
+        release_channels();
+    }
+}
+
+bool EndPoint::removed() const {
+    return removed_;
+}
+
+uint64_t EndPoint::next_bundle_id() {
+    return bundle_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+// Map an RPC status onto a reap code. Only the retryable failures get codes
+// of their own; anything else means retrying would not help.
+static int comms_reap_rc(const ::grpc::Status& status) {
+    switch (status.error_code()) {
+    case ::grpc::StatusCode::OK:
+        return COMMS_SUCCESS;
+    case ::grpc::StatusCode::UNAVAILABLE:
+        return COMMS_UNAVAILABLE;
+    case ::grpc::StatusCode::DEADLINE_EXCEEDED:
+        return COMMS_DEADLINE_EXCEEDED;
+    case ::grpc::StatusCode::RESOURCE_EXHAUSTED:
+        return COMMS_RESOURCE_EXHAUSTED;
+    default:
+        return COMMS_NOT_DELIVERED;
+    }
+}
+
+void EndPoint::set_deposit_queue(std::shared_ptr<BundleQueue> deposit_queue) {
+    deposit_queue_ = deposit_queue;
+}
+
+void EndPoint::set_priority_queue(std::shared_ptr<BundleQueue> priority_queue) {
+    priority_queue_ = priority_queue;
+}
+
+bool EndPoint::deposit_n(comms_bundle_t& bundle,
+                         bool priority) {
     // TODO: What should we do here? Probably shouldn't spin-wait block.
-    return deposit_queue_->try_enqueue(bundle);
+    return deposit_queue(priority)->try_enqueue(bundle);
+}
+
+bool EndPoint::deposit_n(comms_bundle_t& bundle,
+                         moodycamel::ProducerToken& token,
+                         bool priority) {
+    return deposit_queue(priority)->try_enqueue(token, bundle);
+}
+
+// End points without a priority queue of their own (the short-circuited
+// local end point) take priority bundles on their regular queue.
+BundleQueue *EndPoint::deposit_queue(bool priority) const {
+    if (priority and priority_queue_) return priority_queue_.get();
+    return deposit_queue_.get();
 }
 
 //void EndPoint::release_n(const comms_bundle_t& bundle) {
@@ -39,49 +401,162 @@ bool EndPoint::deposit_n(comms_bundle_t& bundle) {
 //    while (not release_queue_->try_enqueue(bundle));
 //}
 
-bool EndPoint::transmit_n(comms_bundle_t& bundle,
-                          size_t retry_count,
-                          size_t retry_delay) {
+// Concatenates the bundle's payloads and compresses them into the block.
+// Bundles that do not shrink go out uncompressed.
+bool EndPoint::compress(const comms_bundle_t& bundle,
+                        ::comms::PacketBundle& packet_bundle) {
+    thread_local std::string payloads;
+    payloads.resize(bundle.bytes_);
+    size_t offset = 0;
+    for (size_t index=0; index<bundle.size(); index++) {
+        memcpy(&payloads[offset], bundle.payload_list_[index], bundle.size_list_[index]);
+        offset += bundle.size_list_[index];
+    }
+
+    std::string *block = packet_bundle.mutable_block();
+    block->resize(comms_codec_bound(codec_, payloads.size()));
+    int64_t start = comms_now_ns();
+    size_t block_size = comms_codec_compress(codec_, codec_level_,
+                                             reinterpret_cast<const uint8_t*>(payloads.data()), payloads.size(),
+                                             reinterpret_cast<uint8_t*>(&(*block)[0]), block->size());
+    int64_t elapsed = comms_now_ns() - start;
+    if (codec_adaptive_) {
+        codec_policy_.record_compression(payloads.size(), block_size > 0 ? block_size : payloads.size(), elapsed);
+    }
+
+    if (block_size == 0 or block_size >= payloads.size()) {
+        packet_bundle.clear_block();
+        return false;
+    }
+    block->resize(block_size);
+    packet_bundle.set_codec(codec_);
+    packet_bundle.set_block_size(static_cast<uint32_t>(payloads.size()));
+    return true;
+}
+
+int EndPoint::transmit_n(comms_bundle_t& bundle,
+                         size_t deadline) {
     size_t packet_count = bundle.size();
-    const comms_packet_t *packet_list = bundle.packet_list();
+
+    // The id is taken on the first attempt and kept by every retry.
+    if (exactly_once_ and bundle.id_ == 0 and packet_count > 0) {
+        bundle.id_ = next_bundle_id();
+    }
+
+    // Broadcasts arrive serialized. This destination's sequence number and
+    // bundle id are appended to the shared slices as a slice of their own;
+    // a protobuf field parses the same wherever it appears.
+    if (bundle.broadcast_ != nullptr) {
+        bool stamped = bundle.sequence_ != 0 or bundle.id_ != 0;
+        ::grpc::ByteBuffer sequenced;
+        if (stamped) {
+            std::vector<::grpc::Slice> slices;
+            bundle.broadcast_->message_.Dump(&slices);
+            ::comms::PacketBundle sequence;
+            sequence.set_sequence(bundle.sequence_);
+            if (bundle.id_ != 0) {
+                sequence.set_epoch(epoch_);
+                sequence.set_bundle_id(bundle.id_);
+            }
+            slices.emplace_back(sequence.SerializeAsString());
+            sequenced = ::grpc::ByteBuffer(slices.data(), slices.size());
+        }
+
+        ::comms::PacketResponse response;
+        auto start = std::chrono::steady_clock::now();
+        ::grpc::Status status = send_message_internal(stamped ? sequenced : bundle.broadcast_->message_,
+                                                      response, deadline);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        int rc = comms_reap_rc(status);
+        record(rc, elapsed.count());
+        if (rc == COMMS_SUCCESS) {
+            grant_credit(bundle.lane(), response.credit_limit());
+            if (response.duplicate()) rc = COMMS_DUPLICATE;
+        }
+        return rc;
+    }
 
     ::google::protobuf::ArenaOptions arena_options;
     arena_options.start_block_size = arena_start_block_size_;
     ::google::protobuf::Arena arena(arena_options);
     ::comms::PacketBundle *packet_bundle = ::google::protobuf::Arena::CreateMessage<::comms::PacketBundle>(&arena);
-    packet_bundle->set_lane(0);
+    packet_bundle->set_src(local_id_);
+    packet_bundle->set_lane(bundle.lane());
+    packet_bundle->set_sequence(bundle.sequence_);
+    if (bundle.id_ != 0) {
+        packet_bundle->set_epoch(epoch_);
+        packet_bundle->set_bundle_id(bundle.id_);
+    }
     packet_bundle->mutable_packet()->Reserve(packet_count);
+    for (uint32_t index=0; index<bundle.trace_count_; index++) {
+        packet_bundle->add_trace(bundle.trace_index_[index]);
+    }
+
+    bool compressed = false;
+    if (codec_ != COMMS_CODEC_NONE and bundle.bytes_ >= codec_min_size_
+            and (not codec_adaptive_ or codec_policy_.compress())) {
+        compressed = compress(bundle, *packet_bundle);
+    }
 
     for (size_t index=0; index<packet_count; index++) {
-        const comms_packet_t *comms_packet = &packet_list[index];
         auto *packet = packet_bundle->add_packet();
-        packet->set_src(comms_packet->submit.dst);
-        packet->set_tag(comms_packet->submit.tag);
-        packet->set_payload(comms_packet->payload, comms_packet->submit.size);
+        packet->set_tag(bundle.tag_list_[index]);
+        if (compressed) {
+            packet->set_size(bundle.size_list_[index]);
+        }
+        else {
+            packet->set_payload(bundle.payload_list_[index], bundle.size_list_[index]);
+        }
     }
 
     ::comms::PacketResponse response;
-    ::grpc::Status status;
+    auto start = std::chrono::steady_clock::now();
+    ::grpc::Status status = send_packets_internal(*packet_bundle, response, deadline);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
 
-    size_t retry = 0;
-    while (retry <= retry_count) {
-        status = send_packets_internal(*packet_bundle, response);
-        if (status.ok()) break;
-        ++retry;
-        std::this_thread::sleep_for(std::chrono::milliseconds(retry_delay));
+    int rc = comms_reap_rc(status);
+    record(rc, elapsed.count());
+    if (rc == COMMS_SUCCESS and codec_adaptive_) {
+        codec_policy_.record_transmit(compressed ? packet_bundle->block().size() : bundle.bytes_, elapsed.count()*1000);
     }
-
-    if (!status.ok()) {
-        std::cerr << "[" << name_ << "] RPC failed: error " << status.error_code()
-                  << ": " << status.error_message() << std::endl;
-        return false;
+    if (rc == COMMS_SUCCESS) {
+        grant_credit(bundle.lane(), response.credit_limit());
+        if (response.duplicate()) rc = COMMS_DUPLICATE;
     }
-
-    return true;
+    return rc;
 }
 
 ::grpc::Status EndPoint::send_packets_internal(::comms::PacketBundle& packets,
-                                               ::comms::PacketResponse& response) {
+                                               ::comms::PacketResponse& response,
+                                               size_t deadline) {
     ::grpc::ClientContext context;
-    return stub_->Send(&context, packets, &response);
+    if (deadline > 0) {
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(deadline));
+    }
+    size_t channel = 0;
+    if (not acquire_channel(channel)) {
+        return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE, "End point was removed.");
+    }
+    ::grpc::Status status = stubs_[channel]->Send(&context, packets, &response);
+    release_channel(channel);
+    return status;
+}
+
+::grpc::Status EndPoint::send_message_internal(const ::grpc::ByteBuffer& message,
+                                               ::comms::PacketResponse& response,
+                                               size_t deadline) {
+    ::grpc::ClientContext context;
+    if (deadline > 0) {
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(deadline));
+    }
+    size_t channel = 0;
+    if (not acquire_channel(channel)) {
+        return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE, "End point was removed.");
+    }
+    ::grpc::Status status = ::grpc::internal::BlockingUnaryCall<::grpc::ByteBuffer, ::comms::PacketResponse,
+                                                                ::grpc::ByteBuffer, ::grpc::protobuf::MessageLite>(
+        channels_[channel].get(), *send_methods_[channel], &context, message, &response);
+    release_channel(channel);
+    return status;
 }
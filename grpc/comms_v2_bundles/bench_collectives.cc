@@ -0,0 +1,277 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+extern "C" {
+#include "comms.h"
+}
+
+// Checks and times the collectives across processes on this host. Start one
+// process per rank, e.g.
+//
+//     for rank in $(seq 0 7); do ./bench_collectives $rank 8 & done; wait
+//
+// Rank r listens on base_port+r. Rank 0 prints all-reduce timings for the
+// tree and ring algorithms and for a naive all-to-all, where every rank
+// sends its whole vector to every other rank and reduces locally.
+
+#define BENCH_COLLECTIVE_LANE  (1)
+#define BENCH_NAIVE_LANE       (0)
+#define BENCH_CHUNK_SIZE       (1<<16)
+#define BENCH_BUNDLE_CHUNKS    (16)
+#define BENCH_REPETITIONS      (5)
+
+#define COMMS_PRINT_ERROR(error) { \
+    std::cerr << "\033[1;31mCOMMS ERROR\033[0m \033[0;32m(" << __FILE__ \
+              << ":" << __LINE__ << ")\033[0m: " << (error) << std::endl; \
+}
+
+#define COMMS_HANDLE_ERROR(rc, error) { \
+    if ((rc)) { \
+        COMMS_PRINT_ERROR(error); \
+        exit(1); \
+    } \
+}
+
+#define BENCH_CHECK(condition, what) { \
+    if (not (condition)) { \
+        std::cerr << "rank " << rank << ": " << (what) << " failed" << std::endl; \
+        exit(1); \
+    } \
+}
+
+static void bench_allreduce_naive(comms_accessor_t *A,
+                                  uint32_t rank,
+                                  uint32_t rank_count,
+                                  uint64_t iteration,
+                                  size_t& early,
+                                  const float *send,
+                                  float *recv,
+                                  size_t count) {
+    char *error = NULL;
+    size_t size = count*sizeof(float);
+    size_t chunk_count = std::max<size_t>(1, (size + BENCH_CHUNK_SIZE - 1) / BENCH_CHUNK_SIZE);
+    memcpy(recv, send, size);
+
+    std::vector<comms_packet_t> packet_list;
+    size_t submitted = 0;
+    for (uint32_t dst=0; dst<rank_count; dst++) {
+        if (dst == rank) continue;
+        for (size_t chunk=0; chunk<chunk_count; chunk++) {
+            comms_packet_t packet;
+            packet.submit.size = static_cast<uint32_t>(std::min<size_t>(BENCH_CHUNK_SIZE, size - chunk*BENCH_CHUNK_SIZE));
+            packet.submit.dst = dst;
+            packet.submit.tag = (iteration << 32) | chunk;
+            packet.payload = (uint8_t*)send + chunk*BENCH_CHUNK_SIZE;
+            packet.opaque = NULL;
+            packet_list.push_back(packet);
+            if (packet_list.size() == BENCH_BUNDLE_CHUNKS or chunk+1 == chunk_count) {
+                int rc = comms_submit(A, packet_list.data(), packet_list.size(), &error);
+                COMMS_HANDLE_ERROR(rc < 0, error);
+                rc = comms_submit_flush(A, &error);
+                COMMS_HANDLE_ERROR(rc < 0, error);
+                submitted += packet_list.size();
+                packet_list.clear();
+            }
+        }
+    }
+
+    // Chunks of the next iteration from peers that are ahead are counted
+    // there; they are only timed, not checked.
+    size_t expected = chunk_count*(rank_count-1);
+    size_t caught = early;
+    size_t reaped = 0;
+    comms_packet_t packets[256];
+    while (caught < expected or reaped < submitted) {
+        int num_caught = comms_catch(A, packets, 256, &error);
+        COMMS_HANDLE_ERROR(num_caught < 0, error);
+        for (int index=0; index<num_caught; index++) {
+            size_t offset = (packets[index].caught.opaque & 0xffffffff)*BENCH_CHUNK_SIZE;
+            const float *values = (const float*)packets[index].payload;
+            float *out = recv + offset/sizeof(float);
+            for (size_t value=0; value<packets[index].caught.size/sizeof(float); value++) {
+                out[value] += values[value];
+            }
+        }
+        if (num_caught > 0) {
+            comms_release(A, packets, num_caught, &error);
+            caught += num_caught;
+        }
+
+        int num_reaped = comms_reap(A, packets, 256, &error);
+        COMMS_HANDLE_ERROR(num_reaped < 0, error);
+        reaped += num_reaped;
+        if (num_caught == 0 and num_reaped == 0) std::this_thread::yield();
+    }
+    early = caught - expected;
+}
+
+template <typename F>
+static double bench_ms(F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int repetition=0; repetition<BENCH_REPETITIONS; repetition++) {
+        f();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count()*1000/BENCH_REPETITIONS;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s rank rank_count [base_port] [element_count]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const uint32_t rank = (uint32_t)atoi(argv[1]);
+    const uint32_t rank_count = (uint32_t)atoi(argv[2]);
+    const int base_port = argc > 3 ? atoi(argv[3]) : 51000;
+    const size_t element_count = argc > 4 ? (size_t)atol(argv[4]) : (1<<20);
+
+    comms_t *C = NULL;
+    comms_collective_t *G = NULL;
+    comms_accessor_t *A = NULL;
+    char *error = NULL;
+    int rc = 0;
+
+    // Define end points.
+    std::vector<std::string> names(rank_count);
+    std::vector<std::string> addresses(rank_count);
+    std::vector<comms_end_point_t> end_point_list(rank_count);
+    for (uint32_t index=0; index<rank_count; index++) {
+        names[index] = "rank" + std::to_string(index);
+        addresses[index] = "127.0.0.1:" + std::to_string(base_port + index);
+        end_point_list[index].name = (char*)names[index].c_str();
+        end_point_list[index].address = (char*)addresses[index].c_str();
+    }
+
+    // Create and configure comms.
+    rc = comms_create(&C, &end_point_list[rank], end_point_list.data(), rank_count, 2, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_configure(C, "base-port", std::to_string(base_port + rank).c_str(), &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_configure(C, "exclusive-lanes", std::to_string(BENCH_COLLECTIVE_LANE).c_str(), &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_configure(C, "writer-retry-count", "100", &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_configure(C, "writer-retry-delay", "100", &error);
+    COMMS_HANDLE_ERROR(rc, error);
+
+    rc = comms_start(C, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_wait_for_start(C, 0.0, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+
+    rc = comms_collective_create(&G, C, BENCH_COLLECTIVE_LANE, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_accessor_create(&A, C, BENCH_NAIVE_LANE, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+
+    // Doubles as a barrier until every rank is up.
+    int32_t one = 1;
+    int32_t ranks = 0;
+    rc = comms_collective_allreduce(G, &one, &ranks, 1, COMMS_DTYPE_INT32, COMMS_OP_SUM, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    BENCH_CHECK(ranks == (int32_t)rank_count, "barrier");
+
+    // Broadcast from the last rank, spanning several chunks.
+    std::vector<uint8_t> message(3*BENCH_CHUNK_SIZE + 17);
+    if (rank == rank_count-1) {
+        for (size_t index=0; index<message.size(); index++) message[index] = (uint8_t)(index*7);
+    }
+    rc = comms_collective_broadcast(G, message.data(), message.size(), rank_count-1, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    for (size_t index=0; index<message.size(); index++) {
+        BENCH_CHECK(message[index] == (uint8_t)(index*7), "broadcast");
+    }
+
+    // Gather to rank 0 and scatter back out.
+    const size_t slice = 1000;
+    std::vector<uint8_t> own(slice, (uint8_t)rank);
+    std::vector<uint8_t> all(slice*rank_count, 0xff);
+    rc = comms_collective_gather(G, own.data(), slice, all.data(), 0, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    if (rank == 0) {
+        for (size_t index=0; index<all.size(); index++) {
+            BENCH_CHECK(all[index] == (uint8_t)(index/slice), "gather");
+        }
+    }
+    std::fill(own.begin(), own.end(), 0xff);
+    rc = comms_collective_scatter(G, all.data(), slice, own.data(), 0, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    for (size_t index=0; index<slice; index++) {
+        BENCH_CHECK(own[index] == (uint8_t)rank, "scatter");
+    }
+
+    // Check both all-reduce algorithms on a few types and operators.
+    const size_t count = element_count;
+    for (const char *algorithm : {"tree", "ring"}) {
+        rc = comms_configure(C, "collective-allreduce", algorithm, &error);
+        COMMS_HANDLE_ERROR(rc, error);
+
+        std::vector<int32_t> ints(count);
+        for (size_t index=0; index<count; index++) ints[index] = (int32_t)(rank + index);
+        rc = comms_collective_allreduce(G, ints.data(), ints.data(), count, COMMS_DTYPE_INT32, COMMS_OP_SUM, &error);
+        COMMS_HANDLE_ERROR(rc, error);
+        for (size_t index=0; index<count; index++) {
+            BENCH_CHECK(ints[index] == (int32_t)(rank_count*(rank_count-1)/2 + rank_count*index), "int32 sum");
+        }
+
+        std::vector<double> doubles(count), maxima(count);
+        for (size_t index=0; index<count; index++) doubles[index] = (double)((rank + index) % rank_count);
+        rc = comms_collective_allreduce(G, doubles.data(), maxima.data(), count, COMMS_DTYPE_FLOAT64, COMMS_OP_MAX, &error);
+        COMMS_HANDLE_ERROR(rc, error);
+        for (size_t index=0; index<count; index++) {
+            BENCH_CHECK(maxima[index] == (double)(rank_count-1), "float64 max");
+        }
+
+        std::vector<int64_t> longs(count);
+        for (size_t index=0; index<count; index++) longs[index] = (int64_t)rank - (int64_t)index;
+        rc = comms_collective_allreduce(G, longs.data(), longs.data(), count, COMMS_DTYPE_INT64, COMMS_OP_MIN, &error);
+        COMMS_HANDLE_ERROR(rc, error);
+        for (size_t index=0; index<count; index++) {
+            BENCH_CHECK(longs[index] == -(int64_t)index, "int64 min");
+        }
+    }
+
+    // Time float sums.
+    std::vector<float> send(count, 1.0f), recv(count);
+    std::vector<double> timings;
+    for (const char *algorithm : {"tree", "ring"}) {
+        rc = comms_configure(C, "collective-allreduce", algorithm, &error);
+        COMMS_HANDLE_ERROR(rc, error);
+        timings.push_back(bench_ms([&]() {
+            int rc = comms_collective_allreduce(G, send.data(), recv.data(), count, COMMS_DTYPE_FLOAT32, COMMS_OP_SUM, &error);
+            COMMS_HANDLE_ERROR(rc, error);
+        }));
+    }
+    uint64_t iteration = 0;
+    size_t early = 0;
+    timings.push_back(bench_ms([&]() {
+        bench_allreduce_naive(A, rank, rank_count, iteration++, early, send.data(), recv.data(), count);
+    }));
+
+    // Nobody shuts down while a peer may still be sending to them.
+    rc = comms_collective_allreduce(G, &one, &ranks, 1, COMMS_DTYPE_INT32, COMMS_OP_SUM, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+
+    if (rank == 0) {
+        printf("ranks %u, %zu floats: tree %.2f ms, ring %.2f ms, all-to-all %.2f ms\n",
+               rank_count, count, timings[0], timings[1], timings[2]);
+    }
+
+    rc = comms_accessor_destroy(A, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_collective_destroy(G, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+
+    comms_shutdown(C, &error);
+    rc = comms_wait_for_shutdown(C, 0.0, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_destroy(C, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+// Feeds random packet lists into per-destination bundles, once packet by
+// packet as submit_n used to and once through comms_partition_t, for a range
+// of destination counts. Also times the destination extraction on its own,
+// scalar against the dispatched (AVX2 where available) version.
+
+#define BENCH_PACKET_COUNT (1024)
+#define BENCH_LIST_COUNT   (64)
+#define BENCH_DURATION_MS  (200)
+
+typedef std::vector<std::vector<comms_packet_t>> bench_lists_t;
+
+static bench_lists_t bench_lists(size_t end_point_count) {
+    std::default_random_engine engine(end_point_count);
+    std::uniform_int_distribution<uint32_t> dst(0, end_point_count-1);
+    bench_lists_t lists(BENCH_LIST_COUNT, std::vector<comms_packet_t>(BENCH_PACKET_COUNT));
+    uint64_t tag = 0;
+    for (auto& list : lists) {
+        for (auto& packet : list) {
+            packet.submit.size = 96;
+            packet.submit.dst = dst(engine);
+            packet.submit.tag = tag++;
+            packet.payload = nullptr;
+            packet.opaque = nullptr;
+        }
+    }
+    return lists;
+}
+
+template <typename F>
+static double bench(const bench_lists_t& lists, F f) {
+    uint64_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed(0);
+    while (elapsed.count()*1000 < BENCH_DURATION_MS) {
+        for (auto& list : lists) {
+            f(list.data(), list.size());
+            count += list.size();
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    return count / elapsed.count() / 1e6;
+}
+
+int main(int argc, char **argv) {
+    printf("%8s %16s %16s %16s %16s\n", "dsts", "loop Mpkt/s", "partition Mpkt/s",
+           "scalar dst Mpkt/s", "simd dst Mpkt/s");
+    for (size_t end_point_count=1; end_point_count<=4096; end_point_count*=4) {
+        bench_lists_t lists = bench_lists(end_point_count);
+        std::vector<comms_bundle_t> bundles(end_point_count);
+        comms_partition_t partition(end_point_count);
+        std::vector<uint32_t> dst_list(BENCH_PACKET_COUNT);
+
+        double loop = bench(lists, [&](const comms_packet_t *packet_list, size_t packet_count) {
+            for (size_t index=0; index<packet_count; index++) {
+                comms_bundle_t& bundle = bundles[packet_list[index].submit.dst];
+                bundle.add(packet_list[index]);
+                if (bundle.size() == COMMS_BUNDLE_SIZE) bundle.clear();
+            }
+        });
+
+        double partitioned = bench(lists, [&](const comms_packet_t *packet_list, size_t packet_count) {
+            partition.run(packet_list, packet_count);
+            if (partition.sparse_) {
+                for (size_t index=0; index<packet_count; index++) {
+                    comms_bundle_t& bundle = bundles[partition.dst_list_[index]];
+                    bundle.add(packet_list[index]);
+                    if (bundle.size() == COMMS_BUNDLE_SIZE) bundle.clear();
+                }
+                return;
+            }
+            for (size_t group=0; group<partition.group_count(); group++) {
+                comms_bundle_t& bundle = bundles[partition.group_dst(group)];
+                const uint32_t *index_list = partition.group_index_list(group);
+                size_t group_size = partition.group_size(group);
+                size_t num_added = 0;
+                while (num_added < group_size) {
+                    size_t count = std::min(group_size-num_added, COMMS_BUNDLE_SIZE-bundle.size());
+                    if (index_list != nullptr) bundle.add_n(packet_list, index_list+num_added, count);
+                    else bundle.add_n(packet_list+num_added, count);
+                    num_added += count;
+                    if (bundle.size() == COMMS_BUNDLE_SIZE) bundle.clear();
+                }
+            }
+        });
+
+        double scalar = bench(lists, [&](const comms_packet_t *packet_list, size_t packet_count) {
+            comms_extract_dst_scalar(packet_list, packet_count, dst_list.data());
+        });
+
+        double simd = bench(lists, [&](const comms_packet_t *packet_list, size_t packet_count) {
+            comms_extract_dst(packet_list, packet_count, dst_list.data());
+        });
+
+        printf("%8zu %16.2f %16.2f %16.2f %16.2f\n", end_point_count, loop, partitioned, scalar, simd);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+// Moves packets through a shared PacketQueue with as many producers as
+// consumers, once through implicit producers and once with per-thread
+// producer/consumer tokens, and reports the throughput of both.
+
+#define BENCH_BURST_SIZE  (64)
+#define BENCH_DURATION_MS (500)
+
+template <bool UseTokens>
+static double bench(size_t thread_count) {
+    PacketQueue queue(1<<20);
+    std::atomic_bool running(true);
+    std::atomic<uint64_t> dequeued(0);
+    std::vector<std::thread> threads;
+
+    for (size_t index=0; index<thread_count; index++) {
+        threads.emplace_back([&]() {
+            comms_packet_t packet_list[BENCH_BURST_SIZE] = {};
+            moodycamel::ProducerToken token(queue);
+            while (running) {
+                bool ok = UseTokens ? queue.try_enqueue_bulk(token, packet_list, BENCH_BURST_SIZE)
+                                    : queue.try_enqueue_bulk(packet_list, BENCH_BURST_SIZE);
+                if (not ok) std::this_thread::yield();
+            }
+        });
+        threads.emplace_back([&]() {
+            comms_packet_t packet_list[BENCH_BURST_SIZE];
+            moodycamel::ConsumerToken token(queue);
+            uint64_t count = 0;
+            while (running) {
+                count += UseTokens ? queue.try_dequeue_bulk(token, packet_list, BENCH_BURST_SIZE)
+                                   : queue.try_dequeue_bulk(packet_list, BENCH_BURST_SIZE);
+            }
+            dequeued += count;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_DURATION_MS));
+    running = false;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return dequeued / elapsed.count() / 1e6;
+}
+
+int main(int argc, char **argv) {
+    printf("%8s %16s %16s\n", "threads", "implicit Mpkt/s", "tokens Mpkt/s");
+    for (size_t thread_count=1; thread_count<=64; thread_count*=2) {
+        double implicit = bench<false>(thread_count);
+        double tokens = bench<true>(thread_count);
+        printf("%8zu %16.2f %16.2f\n", thread_count, implicit, tokens);
+    }
+    return EXIT_SUCCESS;
+}
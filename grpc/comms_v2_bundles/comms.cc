@@ -20,16 +20,132 @@ config_t::config_t()
     , reader_buffer_size(1024)
     , writer_retry_count(25)
     , writer_retry_delay(100)
+    , writer_retry_max_delay(5000)
+    , writer_rpc_deadline(10000)
+    , breaker_failure_threshold(5)
+    , breaker_reset_timeout(1000)
+    , flow_control_window(128)
+    , flow_control_poll_interval(10)
     , writer_thread_count(1)
     , reader_thread_count(1)
     , arena_start_block_depth(20)
-{}
+    , channel_count(1)
+    , channel_policy(COMMS_CHANNEL_ROUND_ROBIN)
+    , max_send_message_size(COMMS_GRPC_DEFAULT)
+    , max_receive_message_size(COMMS_GRPC_DEFAULT)
+    , http2_initial_window_size(COMMS_GRPC_DEFAULT)
+    , http2_bdp_probe(COMMS_GRPC_DEFAULT)
+    , keepalive_time(COMMS_GRPC_DEFAULT)
+    , keepalive_timeout(COMMS_GRPC_DEFAULT)
+    , keepalive_permit_without_calls(COMMS_GRPC_DEFAULT)
+    , compression_algorithm(COMMS_GRPC_DEFAULT)
+    , resource_quota_memory(COMMS_GRPC_DEFAULT)
+    , resource_quota_threads(COMMS_GRPC_DEFAULT)
+    , reuse_port(COMMS_GRPC_DEFAULT)
+    , trace_sample_period(0)
+    , trace_file(NULL)
+    , metrics_port(0)
+    , metrics_socket(NULL)
+    , submit_ring_size(16)
+    , reap_ring_size(1<<16)
+    , bundle_codec(COMMS_CODEC_NONE)
+    , bundle_codec_level(1)
+    , bundle_codec_min_size(4096)
+    , bundle_codec_adaptive(0)
+    , priority_lanes(0)
+    , priority_bundle_size(64)
+    , exclusive_lanes(0)
+    , collective_allreduce(COMMS_ALLREDUCE_AUTO)
+    , collective_timeout(60000)
+    , ordered_lanes(0)
+    , reorder_window(64)
+    , reorder_timeout(1000)
+    , exactly_once(0)
+    , dedup_window(1024)
+{
+    CPU_ZERO(&writer_cpus);
+    CPU_ZERO(&reader_cpus);
+    CPU_ZERO(&receiver_cpus);
+}
+
+void config_t::apply(::grpc::ChannelArguments& args,
+                     ::grpc::ResourceQuota *quota) const {
+    if (max_send_message_size != COMMS_GRPC_DEFAULT) {
+        args.SetMaxSendMessageSize(max_send_message_size);
+    }
+    if (max_receive_message_size != COMMS_GRPC_DEFAULT) {
+        args.SetMaxReceiveMessageSize(max_receive_message_size);
+    }
+    if (http2_initial_window_size != COMMS_GRPC_DEFAULT) {
+        args.SetInt(GRPC_ARG_HTTP2_STREAM_LOOKAHEAD_BYTES, http2_initial_window_size);
+    }
+    if (http2_bdp_probe != COMMS_GRPC_DEFAULT) {
+        args.SetInt(GRPC_ARG_HTTP2_BDP_PROBE, http2_bdp_probe);
+    }
+    if (keepalive_time != COMMS_GRPC_DEFAULT) {
+        args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, keepalive_time);
+    }
+    if (keepalive_timeout != COMMS_GRPC_DEFAULT) {
+        args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, keepalive_timeout);
+    }
+    if (keepalive_permit_without_calls != COMMS_GRPC_DEFAULT) {
+        args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, keepalive_permit_without_calls);
+    }
+    if (compression_algorithm != COMMS_GRPC_DEFAULT) {
+        args.SetCompressionAlgorithm(static_cast<grpc_compression_algorithm>(compression_algorithm));
+    }
+    if (quota != nullptr) {
+        args.SetResourceQuota(*quota);
+    }
+}
+
+void config_t::apply(::grpc::ServerBuilder& builder,
+                     ::grpc::ResourceQuota *quota) const {
+    if (max_send_message_size != COMMS_GRPC_DEFAULT) {
+        builder.SetMaxSendMessageSize(max_send_message_size);
+    }
+    if (max_receive_message_size != COMMS_GRPC_DEFAULT) {
+        builder.SetMaxReceiveMessageSize(max_receive_message_size);
+    }
+    if (http2_initial_window_size != COMMS_GRPC_DEFAULT) {
+        builder.AddChannelArgument(GRPC_ARG_HTTP2_STREAM_LOOKAHEAD_BYTES, http2_initial_window_size);
+    }
+    if (http2_bdp_probe != COMMS_GRPC_DEFAULT) {
+        builder.AddChannelArgument(GRPC_ARG_HTTP2_BDP_PROBE, http2_bdp_probe);
+    }
+    if (keepalive_time != COMMS_GRPC_DEFAULT) {
+        builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIME_MS, keepalive_time);
+    }
+    if (keepalive_timeout != COMMS_GRPC_DEFAULT) {
+        builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, keepalive_timeout);
+    }
+    if (keepalive_permit_without_calls != COMMS_GRPC_DEFAULT) {
+        builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, keepalive_permit_without_calls);
+    }
+    if (compression_algorithm != COMMS_GRPC_DEFAULT) {
+        builder.SetDefaultCompressionAlgorithm(static_cast<grpc_compression_algorithm>(compression_algorithm));
+    }
+    if (quota != nullptr) {
+        builder.SetResourceQuota(*quota);
+    }
+    if (reuse_port != COMMS_GRPC_DEFAULT) {
+        builder.AddChannelArgument(GRPC_ARG_ALLOW_REUSEPORT, reuse_port);
+    }
+}
 
 void config_t::destroy() {
     if (this->process_name) {
         free(this->process_name);
         this->process_name = NULL;
     }
+    if (this->trace_file) {
+        free(this->trace_file);
+        this->trace_file = NULL;
+    }
+    if (this->metrics_socket) {
+        free(this->metrics_socket);
+        this->metrics_socket = NULL;
+    }
     memset(this, 0, sizeof(config_t));
 }
 
@@ -42,36 +158,121 @@ comms_t::comms_t(comms_end_point_t *end_point_list,
     , started_(false)
     , shutting_down_(false)
     , shutdown_(false)
+    , draining_(false)
+    , drain_deadline_ns_(INT64_MAX)
+    , undrained_packets_(0)
+    , skip_count_(0)
     , writers_()
-    , submit_queue_(std::make_shared<moodycamel::ConcurrentQueue<comms_bundle_t,CommsBundleTraits>>(1<<11))
-    , catch_queue_ (std::make_shared<moodycamel::ConcurrentQueue<comms_bundle_t,CommsBundleTraits>>(1<<11))
+    , submit_queue_(nullptr)
+    , priority_queue_(nullptr)
+    , catch_queue_(nullptr)
+    , lane_catch_queues_(lane_count)
+    , lane_matchers_(lane_count)
+    , release_queue_(nullptr)
+    , end_point_table_(nullptr)
+    , connected_(false)
+    , local_index_(0)
+    , membership_version_(0)
+    , rings_version_(0)
+    , next_ring_writer_(0)
+    , metrics_(this)
 {
-    this->end_points_.reserve(end_point_count);
     for (size_t index=0; index<end_point_count; index++) {
-        bool is_local = &end_point_list[index] == this_end_point;
+        if (&end_point_list[index] == this_end_point) {
+            local_index_ = index;
+        }
+    }
 
-        if (COMMS_SHORT_CIRCUIT and &end_point_list[index] == this_end_point) {
-            // For the local end point, short circuit the catch/reap queues.
-            this->end_points_.emplace_back(&end_point_list[index],
-                                           index,
-                                           is_local,
-                                           this->catch_queue_);     // deposit
+    create_queues();
+
+    std::unique_ptr<comms_end_point_table_t> table(new comms_end_point_table_t());
+    table->end_points_.reserve(end_point_count);
+    for (size_t index=0; index<end_point_count; index++) {
+        table->end_points_.push_back(std::make_shared<EndPoint>(&end_point_list[index],
+                                                                index,
+                                                                local_index_,
+                                                                lane_count));
+        bind(*table->end_points_.back(), index);
+    }
+    publish(std::move(table));
+    conf_.end_point_capacity = end_point_count;
+}
+
+// Each queue lives on the NUMA node of the threads that drain it: the
+// writers drain the submit queue, the readers the release queue and the
+// application (the thread creating or starting comms) the catch queues.
+void comms_t::create_queues() {
+    {
+        comms_numa_scope_t scope(comms_numa_node_of(conf_.writer_cpus));
+        submit_queue_ = std::make_shared<BundleQueue>(1<<11);
+        priority_queue_ = std::make_shared<BundleQueue>(1<<8);
+    }
+    {
+        comms_numa_scope_t scope(comms_numa_local_node());
+        catch_queue_ = std::make_shared<BundleQueue>(1<<11);
+    }
+    {
+        comms_numa_scope_t scope(comms_numa_node_of(conf_.reader_cpus));
+        release_queue_ = std::make_shared<PacketQueue>(1<<16);
+    }
+    create_lane_queues();
+}
+
+// Exclusive lanes get a catch queue and matcher of their own.
+void comms_t::create_lane_queues() {
+    comms_numa_scope_t scope(comms_numa_local_node());
+    for (int lane=0; lane<lane_count_; lane++) {
+        if (exclusive_lane(lane)) {
+            lane_catch_queues_[lane] = std::make_shared<BundleQueue>(1<<8);
+            lane_matchers_[lane] = std::unique_ptr<comms_matcher_t>(new comms_matcher_t());
         }
         else {
-            // For remote end points, we submit/reap and catch/release
-            // without a short circuit.
-            this->end_points_.emplace_back(&end_point_list[index],
-                                           index,
-                                           is_local,
-                                           this->submit_queue_);     // deposit
+            lane_catch_queues_[lane].reset();
+            lane_matchers_[lane].reset();
         }
     }
 }
 
 void comms_t::start() {
-    // Set arena starting block size for all end points.
-    for (auto& end_point : end_points_) {
-        end_point.set_arena_start_block_size(1<<conf_.arena_start_block_depth);
+    // The queues were created with comms, before the CPU lists could be
+    // configured. Until an accessor exists nothing else holds on to them, so
+    // they are created again where they belong; later they stay put.
+    {
+        std::unique_lock<std::mutex> lck(stats_mtx_);
+        if (accessors_.empty()) {
+            std::unique_lock<std::mutex> membership_lck(membership_mtx_);
+            create_queues();
+            const std::vector<std::shared_ptr<EndPoint>>& end_points = this->end_points();
+            for (size_t index=0; index<end_points.size(); index++) {
+                bind(*end_points[index], index);
+            }
+        }
+    }
+
+    tracer_.sample_period_ = conf_.trace_sample_period;
+
+    if (conf_.resource_quota_memory != COMMS_GRPC_DEFAULT or conf_.resource_quota_threads != COMMS_GRPC_DEFAULT) {
+        resource_quota_ = std::unique_ptr<::grpc::ResourceQuota>(new ::grpc::ResourceQuota("comms"));
+        if (conf_.resource_quota_memory != COMMS_GRPC_DEFAULT) resource_quota_->Resize(conf_.resource_quota_memory);
+        if (conf_.resource_quota_threads != COMMS_GRPC_DEFAULT) resource_quota_->SetMaxThreads(conf_.resource_quota_threads);
+    }
+
+    // Scraping is best effort; a listener that can't bind is reported but
+    // does not keep comms from starting.
+    if ((conf_.metrics_port != 0 or conf_.metrics_socket != NULL)
+            and not metrics_.start(conf_.metrics_port, conf_.metrics_socket)) {
+        std::cerr << "Unable to start metrics listener" << std::endl;
+    }
+
+    // End points added from here on are connected as they are added.
+    {
+        std::unique_lock<std::mutex> lck(membership_mtx_);
+        const std::vector<std::shared_ptr<EndPoint>>& end_points = this->end_points();
+        for (size_t index=0; index<end_points.size(); index++) {
+            if (end_points[index]->removed()) continue;
+            connect(*end_points[index]);
+        }
+        connected_ = true;
     }
 
     // First, start all readers.
@@ -84,12 +285,12 @@ void comms_t::start() {
     // Next, start the receiver.
     std::stringstream addr;
     addr << "[::]:" << conf_.base_port;
-    receiver_ = std::make_shared<comms_receiver_t>(readers_);
+    receiver_ = std::make_shared<comms_receiver_t>(this, readers_);
     receiver_->start(addr.str());
 
     // Lastly, start the writers.
     for (uint32_t index=0; index<conf_.writer_thread_count; index++) {
-        auto writer = std::make_shared<comms_writer_t>(this);
+        auto writer = std::make_shared<comms_writer_t>(this, index);
         writers_.push_back(writer);
         writer->start(receiver_);
     }
@@ -103,11 +304,15 @@ void comms_t::shutdown() {
     // Indicate intention to shut down.
     shutting_down_ = true;
 
-    // First, shut down all writers.
+    // First, shut down all writers. Bundles still queued once they have all
+    // stopped will not be sent.
     for (auto writer : writers_) {
         writer->shutdown();
         writer->wait_for_shutdown();
     }
+    if (not writers_.empty()) {
+        writers_.back()->reap_undrained(true);
+    }
 
     // Next, shut down the receiver.
     receiver_->shutdown();
@@ -119,6 +324,13 @@ void comms_t::shutdown() {
         reader->wait_for_shutdown();
     }
 
+    // Every stage has been stamped by now, write out the trace.
+    if (conf_.trace_file != NULL and not trace_dump(conf_.trace_file)) {
+        std::cerr << "Unable to write trace to " << conf_.trace_file << std::endl;
+    }
+
+    metrics_.shutdown();
+
     // Acquire shutdown mutex and notify shutdown.
     std::unique_lock<std::mutex> lck(shutdown_mtx_);
     shutdown_ = true;
@@ -154,6 +366,47 @@ bool comms_t::wait_for_start(double timeout) {
     return started_;
 }
 
+bool comms_t::drain(double timeout) {
+    drain_deadline_ns_ = timeout > 0.0 ? comms_now_ns() + static_cast<int64_t>(timeout * 1e9) : INT64_MAX;
+    draining_ = true;
+
+    // Submits that started before the drain are waited out; later ones see
+    // it and back off, leaving the accessors to this thread.
+    {
+        std::unique_lock<std::mutex> lck(stats_mtx_);
+        for (comms_accessor_t *A : accessors_) {
+            while (A->submitting_.load()) {
+                std::this_thread::yield();
+            }
+            A->submit_flush();
+        }
+    }
+
+    shutdown();
+    return undrained_packets_ == 0;
+}
+
+bool comms_t::drain_expired() const {
+    return draining_.load(std::memory_order_relaxed) and comms_now_ns() >= drain_deadline_ns_.load(std::memory_order_relaxed);
+}
+
+// Records the sequence number of a bundle that will not be delivered, if it
+// has one. Nothing is sent once shutting down.
+void comms_t::skip(const comms_bundle_t& bundle) {
+    if (bundle.sequence_ == 0 or shutting_down_) return;
+
+    std::unique_lock<std::mutex> lck(skips_mtx_);
+    skips_.push_back({bundle.dst_, bundle.lane_, bundle.sequence_});
+    skip_count_++;
+}
+
+void comms_t::take_skips(std::vector<comms_skip_t>& skips) {
+    std::unique_lock<std::mutex> lck(skips_mtx_);
+    skips.swap(skips_);
+    skips_.clear();
+    skip_count_ = 0;
+}
+
 bool comms_t::wait_for_shutdown(double timeout) {
     std::unique_lock<std::mutex> lck(shutdown_mtx_);
 
@@ -174,7 +427,108 @@ bool comms_t::wait_for_shutdown(double timeout) {
     return shutdown_;
 }
 
+const std::vector<std::shared_ptr<EndPoint>>& comms_t::end_points() const {
+    return end_point_table_.load(std::memory_order_acquire)->end_points_;
+}
+
+// Called with membership_mtx_ held, or from the constructor.
+void comms_t::publish(std::unique_ptr<comms_end_point_table_t> table) {
+    end_point_table_.store(table.get(), std::memory_order_release);
+    end_point_tables_.push_back(std::move(table));
+}
+
+// Points the end point at its deposit queues, before it is published.
+void comms_t::bind(EndPoint& end_point,
+                   size_t index) {
+    if (COMMS_SHORT_CIRCUIT and index == local_index_) {
+        // For the local end point, short circuit the catch/reap queues.
+        end_point.set_deposit_queue(catch_queue_);
+    }
+    else {
+        // For remote end points, we submit/reap and catch/release
+        // without a short circuit.
+        end_point.set_deposit_queue(submit_queue_);
+        end_point.set_priority_queue(priority_queue_);
+    }
+}
+
+// Opens the end point's channel pool.
+void comms_t::connect(EndPoint& end_point) {
+    end_point.set_arena_start_block_size(1<<conf_.arena_start_block_depth);
+    end_point.create_channels(conf_, resource_quota_.get());
+}
+
+bool comms_t::priority_lane(int lane) const {
+    return lane < 64 and (conf_.priority_lanes >> lane) & 1;
+}
+
+bool comms_t::exclusive_lane(int lane) const {
+    return lane < 64 and (conf_.exclusive_lanes >> lane) & 1;
+}
+
+bool comms_t::ordered_lane(int lane) const {
+    return lane < 64 and (conf_.ordered_lanes >> lane) & 1;
+}
+
+BundleQueue *comms_t::catch_queue(uint32_t lane) const {
+    if (lane < lane_catch_queues_.size() and lane_catch_queues_[lane]) {
+        return lane_catch_queues_[lane].get();
+    }
+    return catch_queue_.get();
+}
+
+// Matchers go with the catch queues.
+comms_matcher_t& comms_t::matcher(uint32_t lane) {
+    if (lane < lane_matchers_.size() and lane_matchers_[lane]) {
+        return *lane_matchers_[lane];
+    }
+    return matcher_;
+}
+
+// Packets that were never caught, or caught and never matched, still hold
+// their catch blocks, as do packets released after the readers stopped.
+// Short-circuited packets point back at their sender's reap queue instead
+// and have no block.
+static void comms_unref_packets(const comms_packet_t packet_list[],
+                                size_t packet_count,
+                                PacketQueue *release_queue) {
+    for (size_t index=0; index<packet_count; index++) {
+        if (packet_list[index].opaque != release_queue) continue;
+        comms_catch_block_t *block = comms_catch_block_t::from_payload(packet_list[index].payload);
+        if (block->unref(1)) block->destroy();
+    }
+}
+
 void comms_t::destroy() {
+    metrics_.shutdown();
+
+    comms_bundle_t bundle;
+    std::vector<BundleQueue*> queues = {catch_queue_.get()};
+    for (auto& queue : lane_catch_queues_) {
+        if (queue) queues.push_back(queue.get());
+    }
+    for (BundleQueue *queue : queues) {
+        while (queue->try_dequeue(bundle)) {
+            if (bundle.size() == 0 or bundle.opaque_ != release_queue_.get()) continue;
+            comms_catch_block_t *block = comms_catch_block_t::from_payload(bundle.payload_list_[0]);
+            if (block->unref(bundle.size())) block->destroy();
+        }
+    }
+
+    comms_packet_t packet_list[COMMS_BUNDLE_GATHER_SIZE];
+    std::vector<comms_matcher_t*> matchers = {&matcher_};
+    for (auto& matcher : lane_matchers_) {
+        if (matcher) matchers.push_back(matcher.get());
+    }
+    for (comms_matcher_t *matcher : matchers) {
+        while (size_t count = matcher->take(0, 0, packet_list, COMMS_BUNDLE_GATHER_SIZE)) {
+            comms_unref_packets(packet_list, count, release_queue_.get());
+        }
+    }
+    while (size_t count = release_queue_->try_dequeue_bulk(packet_list, COMMS_BUNDLE_GATHER_SIZE)) {
+        comms_unref_packets(packet_list, count, release_queue_.get());
+    }
+
     this->conf_.destroy();
 }
 
@@ -196,6 +550,43 @@ int comms_create(comms_t **C,
     }
 }
 
+static int comms_configure_cpus(cpu_set_t *cpus,
+                                const char *value,
+                                char **error) {
+    if (not comms_parse_cpus(value, cpus)) {
+        std::stringstream ss;
+        ss << "Invalid CPU list. Expected e.g. 0-3,8,10-11; Value provided: " << value;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    return 0;
+}
+
+// Same list syntax as the CPU sets, e.g. "0,2-3".
+static int comms_configure_lanes(comms_t *C,
+                                 uint64_t *lanes,
+                                 const char *kind,
+                                 const char *value,
+                                 char **error) {
+    cpu_set_t lane_set;
+    uint64_t lane_mask = 0;
+    bool ok = comms_parse_cpus(value, &lane_set);
+    for (int lane=0; ok and lane<CPU_SETSIZE; lane++) {
+        if (not CPU_ISSET(lane, &lane_set)) continue;
+        if (lane >= 64 or lane >= C->lane_count_) ok = false;
+        else lane_mask |= uint64_t(1) << lane;
+    }
+    if (not ok) {
+        std::stringstream ss;
+        ss << "Invalid " << kind << " lane list. Lanes must be in [0, " << std::min(C->lane_count_, 64)
+           << "); Value provided: " << value;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    *lanes = lane_mask;
+    return 0;
+}
+
 int comms_configure(comms_t *C,
                     const char *key,
                     const char *value,
@@ -217,6 +608,24 @@ int comms_configure(comms_t *C,
     else if (strncmp(key, "writer-retry-delay", 18) == 0) {
         C->conf_.writer_retry_delay = (size_t)atoi(value);
     }
+    else if (strncmp(key, "writer-retry-max-delay", 22) == 0) {
+        C->conf_.writer_retry_max_delay = (size_t)atoi(value);
+    }
+    else if (strncmp(key, "writer-rpc-deadline", 19) == 0) {
+        C->conf_.writer_rpc_deadline = (size_t)atoi(value);
+    }
+    else if (strncmp(key, "breaker-failure-threshold", 25) == 0) {
+        C->conf_.breaker_failure_threshold = (uint32_t)atoi(value);
+    }
+    else if (strncmp(key, "breaker-reset-timeout", 21) == 0) {
+        C->conf_.breaker_reset_timeout = (size_t)atoi(value);
+    }
+    else if (strncmp(key, "flow-control-window", 19) == 0) {
+        C->conf_.flow_control_window = (uint32_t)atoi(value);
+    }
+    else if (strncmp(key, "flow-control-poll-interval", 26) == 0) {
+        C->conf_.flow_control_poll_interval = (size_t)atoi(value);
+    }
     else if (strncmp(key, "writer-thread-count", 19) == 0) {
         C->conf_.writer_thread_count = (uint32_t)atoi(value);
     }
@@ -226,6 +635,234 @@ int comms_configure(comms_t *C,
     else if (strncmp(key, "arena-start-block-depth", 19) == 0) {
         C->conf_.arena_start_block_depth = (uint32_t)atoi(value);
     }
+    else if (strncmp(key, "channels-per-end-point", 22) == 0) {
+        int channel_count = atoi(value);
+        if (channel_count < 1) {
+            std::stringstream ss;
+            ss << "Invalid channel count. Must be at least 1; Value provided: " << value;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+        C->conf_.channel_count = (uint32_t)channel_count;
+    }
+    else if (strncmp(key, "channel-policy", 14) == 0) {
+        if (strcmp(value, "round-robin") == 0) {
+            C->conf_.channel_policy = COMMS_CHANNEL_ROUND_ROBIN;
+        }
+        else if (strcmp(value, "least-loaded") == 0) {
+            C->conf_.channel_policy = COMMS_CHANNEL_LEAST_LOADED;
+        }
+        else {
+            std::stringstream ss;
+            ss << "Invalid channel policy. Valid values: round-robin, least-loaded; Value provided: " << value;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+    }
+    else if (strncmp(key, "max-send-message-size", 21) == 0) {
+        C->conf_.max_send_message_size = atoi(value);
+    }
+    else if (strncmp(key, "max-receive-message-size", 24) == 0) {
+        C->conf_.max_receive_message_size = atoi(value);
+    }
+    else if (strncmp(key, "http2-initial-window-size", 25) == 0) {
+        C->conf_.http2_initial_window_size = atoi(value);
+    }
+    else if (strncmp(key, "http2-bdp-probe", 15) == 0) {
+        C->conf_.http2_bdp_probe = atoi(value) ? 1 : 0;
+    }
+    else if (strncmp(key, "keepalive-timeout", 17) == 0) {
+        C->conf_.keepalive_timeout = atoi(value);
+    }
+    else if (strncmp(key, "keepalive-time", 14) == 0) {
+        C->conf_.keepalive_time = atoi(value);
+    }
+    else if (strncmp(key, "keepalive-permit-without-calls", 30) == 0) {
+        C->conf_.keepalive_permit_without_calls = atoi(value) ? 1 : 0;
+    }
+    else if (strncmp(key, "compression", 11) == 0) {
+        if (strcmp(value, "none") == 0) {
+            C->conf_.compression_algorithm = GRPC_COMPRESS_NONE;
+        }
+        else if (strcmp(value, "deflate") == 0) {
+            C->conf_.compression_algorithm = GRPC_COMPRESS_DEFLATE;
+        }
+        else if (strcmp(value, "gzip") == 0) {
+            C->conf_.compression_algorithm = GRPC_COMPRESS_GZIP;
+        }
+        else {
+            std::stringstream ss;
+            ss << "Invalid compression algorithm. Valid values: none, deflate, gzip; Value provided: " << value;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+    }
+    else if (strncmp(key, "resource-quota-memory", 21) == 0) {
+        C->conf_.resource_quota_memory = (int64_t)strtoll(value, NULL, 10);
+    }
+    else if (strncmp(key, "resource-quota-threads", 22) == 0) {
+        C->conf_.resource_quota_threads = atoi(value);
+    }
+    else if (strncmp(key, "so-reuseport", 12) == 0) {
+        C->conf_.reuse_port = atoi(value) ? 1 : 0;
+    }
+    else if (strncmp(key, "trace-sample-period", 19) == 0) {
+        C->conf_.trace_sample_period = (uint32_t)atoi(value);
+    }
+    else if (strncmp(key, "metrics-port", 12) == 0) {
+        C->conf_.metrics_port = (uint16_t)atoi(value);
+    }
+    else if (strncmp(key, "metrics-socket", 14) == 0) {
+        free(C->conf_.metrics_socket);
+        C->conf_.metrics_socket = (char*)calloc(len+1, sizeof(char));
+        strncpy(C->conf_.metrics_socket, value, len+1);
+    }
+    else if (strncmp(key, "submit-ring-size", 16) == 0) {
+        C->conf_.submit_ring_size = (size_t)atoi(value);
+    }
+    else if (strncmp(key, "reap-ring-size", 14) == 0) {
+        C->conf_.reap_ring_size = (size_t)atoi(value);
+    }
+    else if (strncmp(key, "priority-lanes", 14) == 0) {
+        return comms_configure_lanes(C, &C->conf_.priority_lanes, "priority", value, error);
+    }
+    else if (strncmp(key, "exclusive-lanes", 15) == 0) {
+        if (C->started_ or not C->accessors_.empty()) {
+            std::stringstream ss;
+            ss << "Exclusive lanes must be set before comms starts and accessors are created.";
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+        if (comms_configure_lanes(C, &C->conf_.exclusive_lanes, "exclusive", value, error) != 0) {
+            return 1;
+        }
+        C->create_lane_queues();
+    }
+    else if (strncmp(key, "ordered-lanes", 13) == 0) {
+        return comms_configure_lanes(C, &C->conf_.ordered_lanes, "ordered", value, error);
+    }
+    else if (strncmp(key, "reorder-window", 14) == 0) {
+        size_t window = (size_t)atoi(value);
+        if (window == 0) {
+            std::stringstream ss;
+            ss << "Invalid reorder window. Must be at least 1; Value provided: " << value;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+        C->conf_.reorder_window = window;
+    }
+    else if (strncmp(key, "reorder-timeout", 15) == 0) {
+        C->conf_.reorder_timeout = (size_t)atoi(value);
+    }
+    else if (strncmp(key, "exactly-once", 12) == 0) {
+        C->conf_.exactly_once = atoi(value) ? 1 : 0;
+    }
+    else if (strncmp(key, "end-point-capacity", 18) == 0) {
+        size_t capacity = (size_t)atoi(value);
+        if (C->started_ or not C->accessors_.empty()) {
+            std::stringstream ss;
+            ss << "End point capacity must be set before comms starts and accessors are created.";
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+        if (capacity < C->end_points().size()) {
+            std::stringstream ss;
+            ss << "Invalid end point capacity. Must be at least the number of end points ("
+               << C->end_points().size() << "); Value provided: " << value;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+        C->conf_.end_point_capacity = capacity;
+    }
+    else if (strncmp(key, "dedup-window", 12) == 0) {
+        size_t window = (size_t)atoi(value);
+        if (window == 0) {
+            std::stringstream ss;
+            ss << "Invalid dedup window. Must be at least 1; Value provided: " << value;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+        C->conf_.dedup_window = window;
+    }
+    else if (strncmp(key, "collective-allreduce", 20) == 0) {
+        if (strncmp(value, "auto", 4) == 0) {
+            C->conf_.collective_allreduce = COMMS_ALLREDUCE_AUTO;
+        }
+        else if (strncmp(value, "ring", 4) == 0) {
+            C->conf_.collective_allreduce = COMMS_ALLREDUCE_RING;
+        }
+        else if (strncmp(value, "tree", 4) == 0) {
+            C->conf_.collective_allreduce = COMMS_ALLREDUCE_TREE;
+        }
+        else {
+            std::stringstream ss;
+            ss << "Invalid all-reduce algorithm. Valid values: auto, ring, tree; Value provided: " << value;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+    }
+    else if (strncmp(key, "collective-timeout", 18) == 0) {
+        C->conf_.collective_timeout = (size_t)atoi(value);
+    }
+    else if (strncmp(key, "priority-bundle-size", 20) == 0) {
+        size_t size = (size_t)atoi(value);
+        if (size == 0 or size > COMMS_BUNDLE_SIZE) {
+            std::stringstream ss;
+            ss << "Invalid priority bundle size. Valid range: [1, " << COMMS_BUNDLE_SIZE
+               << "]; Value provided: " << value;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+        C->conf_.priority_bundle_size = size;
+    }
+    else if (strncmp(key, "bundle-codec-level", 18) == 0) {
+        C->conf_.bundle_codec_level = atoi(value);
+    }
+    else if (strncmp(key, "bundle-codec-min-size", 21) == 0) {
+        C->conf_.bundle_codec_min_size = (size_t)atoi(value);
+    }
+    else if (strncmp(key, "bundle-codec-adaptive", 21) == 0) {
+        C->conf_.bundle_codec_adaptive = atoi(value) ? 1 : 0;
+    }
+    else if (strncmp(key, "bundle-codec", 12) == 0) {
+        int codec;
+        if (strcmp(value, "none") == 0) {
+            codec = COMMS_CODEC_NONE;
+        }
+        else if (strcmp(value, "lz4") == 0) {
+            codec = COMMS_CODEC_LZ4;
+        }
+        else if (strcmp(value, "zstd") == 0) {
+            codec = COMMS_CODEC_ZSTD;
+        }
+        else {
+            std::stringstream ss;
+            ss << "Invalid bundle codec. Valid values: none, lz4, zstd; Value provided: " << value;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+        if (not comms_codec_available(codec)) {
+            std::stringstream ss;
+            ss << "Bundle codec " << value << " is not available in this build (see COMMS_LZ4 and COMMS_ZSTD in the Makefile).";
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+        C->conf_.bundle_codec = codec;
+    }
+    else if (strncmp(key, "writer-cpus", 11) == 0) {
+        return comms_configure_cpus(&C->conf_.writer_cpus, value, error);
+    }
+    else if (strncmp(key, "reader-cpus", 11) == 0) {
+        return comms_configure_cpus(&C->conf_.reader_cpus, value, error);
+    }
+    else if (strncmp(key, "receiver-cpus", 13) == 0) {
+        return comms_configure_cpus(&C->conf_.receiver_cpus, value, error);
+    }
+    else if (strncmp(key, "trace-file", 10) == 0) {
+        free(C->conf_.trace_file);
+        C->conf_.trace_file = (char*)calloc(len+1, sizeof(char));
+        strncpy(C->conf_.trace_file, value, len+1);
+    }
     return 0;
 }
 
@@ -240,6 +877,84 @@ int comms_destroy(comms_t *C,
     return 0;
 }
 
+int comms_end_point_health(comms_t *C,
+                           size_t end_point,
+                           comms_end_point_health_t *health,
+                           char **error) {
+    if (end_point >= C->end_points().size()) {
+        std::stringstream ss;
+        ss << "Invalid end point. Valid range: [0, " << C->end_points().size()
+           << "); End point provided: " << end_point;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    C->end_points()[end_point]->health(health);
+    return 0;
+}
+
+int comms_add_end_point(comms_t *C,
+                        comms_end_point_t *end_point,
+                        size_t *index,
+                        char **error) {
+    std::unique_lock<std::mutex> lck(C->membership_mtx_);
+    const std::vector<std::shared_ptr<EndPoint>>& end_points = C->end_points();
+    if (end_points.size() >= C->conf_.end_point_capacity) {
+        std::stringstream ss;
+        ss << "Cannot add end point, end point capacity reached. Capacity: "
+           << C->conf_.end_point_capacity;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    try {
+        size_t new_index = end_points.size();
+        std::shared_ptr<EndPoint> added = std::make_shared<EndPoint>(end_point, new_index, C->local_index_, C->lane_count_);
+        C->bind(*added, new_index);
+        if (C->connected_) {
+            C->connect(*added);
+        }
+
+        std::unique_ptr<comms_end_point_table_t> table(new comms_end_point_table_t());
+        table->end_points_ = end_points;
+        table->end_points_.push_back(added);
+        C->publish(std::move(table));
+        C->membership_version_++;
+        index[0] = new_index;
+        return 0;
+    }
+    catch (std::bad_alloc& e) {
+        std::stringstream ss;
+        ss << "Unable to allocate end point.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+}
+
+int comms_remove_end_point(comms_t *C,
+                           size_t index,
+                           char **error) {
+    std::unique_lock<std::mutex> lck(C->membership_mtx_);
+    const std::vector<std::shared_ptr<EndPoint>>& end_points = C->end_points();
+    if (index >= end_points.size()) {
+        std::stringstream ss;
+        ss << "Invalid end point. Valid range: [0, " << end_points.size()
+           << "); End point provided: " << index;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    if (index == C->local_index_) {
+        std::stringstream ss;
+        ss << "Cannot remove the local end point.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    end_points[index]->remove();
+    C->membership_version_++;
+    return 0;
+}
+
 int comms_start(comms_t *C,
                 char **error) {
     C->start();
@@ -287,14 +1002,79 @@ int comms_submit(comms_accessor_t *A,
         return -1;
     }
 
-    if (A->C_->shutting_down_) {
+    comms_submit_scope_t scope(A);
+    if (not scope.open()) {
         std::stringstream ss;
-        ss << "Cannot submit packets while comms layer is shutting down.";
+        ss << "Cannot submit packets while comms layer is draining or shutting down.";
         comms_set_error(error, ss.str().c_str());
         return -1;
     }
 
+    const size_t end_point_count = A->C_->end_points().size();
+    for (size_t index=0; index<packet_count; index++) {
+        if (packet_list[index].submit.dst >= end_point_count) {
+            std::stringstream ss;
+            ss << "Invalid destination. Valid range: [0, " << end_point_count
+               << "); End point provided: " << packet_list[index].submit.dst;
+            comms_set_error(error, ss.str().c_str());
+            return -1;
+        }
+    }
+
     A->submit_n(packet_list, packet_count);
+
+    // Priority lanes don't hold packets back waiting for a bundle to fill.
+    if (A->priority_) {
+        A->submit_flush();
+    }
+    return static_cast<int>(packet_count);
+}
+
+int comms_submit_broadcast(comms_accessor_t *A,
+                           comms_packet_t packet_list[],
+                           size_t packet_count,
+                           const uint32_t dst_list[],
+                           size_t dst_count,
+                           char **error) {
+    if (A->C_ == NULL) {
+        std::stringstream ss;
+        ss << "Cannot submit packets, accessor is not bound to a comms object.";
+        comms_set_error(error, ss.str().c_str());
+        return -1;
+    }
+
+    comms_submit_scope_t scope(A);
+    if (not scope.open()) {
+        std::stringstream ss;
+        ss << "Cannot submit packets while comms layer is draining or shutting down.";
+        comms_set_error(error, ss.str().c_str());
+        return -1;
+    }
+
+    // All end points means those currently in the membership.
+    const std::vector<std::shared_ptr<EndPoint>>& end_points = A->C_->end_points();
+    std::vector<uint32_t> all_end_points;
+    if (dst_list == NULL) {
+        for (size_t index=0; index<end_points.size(); index++) {
+            if (end_points[index]->removed()) continue;
+            all_end_points.push_back(static_cast<uint32_t>(index));
+        }
+        dst_list = all_end_points.data();
+        dst_count = all_end_points.size();
+    }
+
+    for (size_t index=0; index<dst_count; index++) {
+        if (dst_list[index] >= end_points.size()) {
+            std::stringstream ss;
+            ss << "Invalid broadcast destination. Valid range: [0, " << end_points.size()
+               << "); End point provided: " << dst_list[index];
+            comms_set_error(error, ss.str().c_str());
+            return -1;
+        }
+    }
+    if (dst_count == 0) return 0;
+
+    A->submit_broadcast_n(packet_list, packet_count, dst_list, dst_count);
     return static_cast<int>(packet_count);
 }
 
@@ -307,9 +1087,10 @@ int comms_submit_flush(comms_accessor_t *A,
         return -1;
     }
 
-    if (A->C_->shutting_down_) {
+    comms_submit_scope_t scope(A);
+    if (not scope.open()) {
         std::stringstream ss;
-        ss << "Cannot flush packets while comms layer is shutting down. Must flush before shutting down comms layer.";
+        ss << "Cannot flush packets while comms layer is draining or shutting down. Must flush before shutting down comms layer.";
         comms_set_error(error, ss.str().c_str());
         return -1;
     }
@@ -331,6 +1112,41 @@ int comms_reap(comms_accessor_t *A,
     return A->reap_n(packet_list, packet_count);
 }
 
+int comms_payload_alloc(comms_accessor_t *A,
+                        size_t size,
+                        int flags,
+                        uint8_t **payload,
+                        char **error) {
+    try {
+        payload[0] = A->payloads_.alloc(size, (flags & COMMS_PAYLOAD_RECYCLE) != 0);
+    }
+    catch (std::bad_alloc& e) {
+        payload[0] = nullptr;
+    }
+
+    if (payload[0] == nullptr) {
+        std::stringstream ss;
+        ss << "Unable to allocate payload. Size: " << size;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int comms_payload_free(comms_accessor_t *A,
+                       uint8_t *payload,
+                       char **error) {
+    if (payload == NULL) return 0;
+
+    if (not A->payloads_.free(payload)) {
+        std::stringstream ss;
+        ss << "Payload was not allocated by this accessor or was already freed.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    return 0;
+}
+
 int comms_catch(comms_accessor_t *A,
                 comms_packet_t packet_list[],
                 size_t packet_count,
@@ -352,6 +1168,29 @@ int comms_catch(comms_accessor_t *A,
     return A->catch_n(packet_list, packet_count);
 }
 
+int comms_catch_matching(comms_accessor_t *A,
+                         uint64_t tag,
+                         uint64_t mask,
+                         comms_packet_t packet_list[],
+                         size_t packet_count,
+                         char **error) {
+    if (A->C_ == NULL) {
+        std::stringstream ss;
+        ss << "Cannot catch packets, accessor not bound to a comms object.";
+        comms_set_error(error, ss.str().c_str());
+        return -1;
+    }
+
+    if (A->C_->shutdown_) {
+        std::stringstream ss;
+        ss << "Cannot catch packets, comms layer is shut down.";
+        comms_set_error(error, ss.str().c_str());
+        return -1;
+    }
+
+    return A->catch_matching_n(tag, mask, packet_list, packet_count);
+}
+
 int comms_release(comms_accessor_t *A,
                   comms_packet_t packet_list[],
                   size_t packet_count,
@@ -365,3 +1204,23 @@ int comms_shutdown(comms_t *C,
     C->shutdown();
     return 0;
 }
+
+int comms_drain(comms_t *C,
+                double timeout,
+                char **error) {
+    if (not C->started_ or C->draining_ or C->shutting_down_) {
+        std::stringstream ss;
+        ss << "Cannot drain, comms layer is not running.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    if (not C->drain(timeout)) {
+        std::stringstream ss;
+        ss << "Drain deadline passed before all packets were sent. Packets not drained: "
+           << C->undrained_packets_.load();
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    return 0;
+}
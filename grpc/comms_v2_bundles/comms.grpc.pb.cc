@@ -0,0 +1,15 @@
+#include "comms.pb.h"
+#include "comms.grpc.pb.h"
+namespace comms {
+
+static const char* Comms_method_names[] = {"/comms.Comms/Send"};
+std::unique_ptr< Comms::Stub> Comms::NewStub(const std::shared_ptr< ::grpc::ChannelInterface>& channel, const ::grpc::StubOptions& options) { return std::unique_ptr< Comms::Stub>(new Comms::Stub(channel, options)); }
+Comms::Stub::Stub(const std::shared_ptr< ::grpc::ChannelInterface>& channel, const ::grpc::StubOptions& options) : channel_(channel), rpcmethod_Send_(Comms_method_names[0], options.suffix_for_stats(), ::grpc::internal::RpcMethod::NORMAL_RPC, channel) {}
+::grpc::Status Comms::Stub::Send(::grpc::ClientContext* context, const ::comms::PacketBundle& request, ::comms::PacketResponse* response) { return ::grpc::internal::BlockingUnaryCall< ::comms::PacketBundle, ::comms::PacketResponse, ::grpc::protobuf::MessageLite, ::grpc::protobuf::MessageLite>(channel_.get(), rpcmethod_Send_, context, request, response); }
+Comms::Service::Service() {
+  AddMethod(new ::grpc::internal::RpcServiceMethod(Comms_method_names[0], ::grpc::internal::RpcMethod::NORMAL_RPC, new ::grpc::internal::RpcMethodHandler< Comms::Service, ::comms::PacketBundle, ::comms::PacketResponse, ::grpc::protobuf::MessageLite, ::grpc::protobuf::MessageLite>([](Comms::Service* service, ::grpc::ServerContext* ctx, const ::comms::PacketBundle* req, ::comms::PacketResponse* resp) { return service->Send(ctx, req, resp); }, this)));
+}
+Comms::Service::~Service() {}
+::grpc::Status Comms::Service::Send(::grpc::ServerContext*, const ::comms::PacketBundle*, ::comms::PacketResponse*) { return ::grpc::Status(::grpc::StatusCode::UNIMPLEMENTED, ""); }
+}  // namespace
+
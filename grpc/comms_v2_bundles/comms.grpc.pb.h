@@ -0,0 +1,47 @@
+#pragma once
+#include "comms.pb.h"
+#include <functional>
+#include <grpcpp/impl/codegen/async_unary_call.h>
+#include <grpcpp/impl/codegen/client_unary_call.h>
+#include <grpcpp/impl/codegen/completion_queue.h>
+#include <grpcpp/impl/codegen/method_handler.h>
+#include <grpcpp/impl/codegen/proto_utils.h>
+#include <grpcpp/impl/codegen/rpc_method.h>
+#include <grpcpp/impl/codegen/rpc_service_method.h>
+#include <grpcpp/impl/codegen/server_context.h>
+#include <grpcpp/impl/codegen/service_type.h>
+#include <grpcpp/impl/codegen/status.h>
+#include <grpcpp/impl/codegen/stub_options.h>
+#include <grpcpp/channel.h>
+namespace comms {
+
+class Comms final {
+ public:
+  class Stub final {
+   public:
+    Stub(const std::shared_ptr< ::grpc::ChannelInterface>& channel, const ::grpc::StubOptions& options = ::grpc::StubOptions());
+    ::grpc::Status Send(::grpc::ClientContext* context, const ::comms::PacketBundle& request, ::comms::PacketResponse* response);
+   private:
+    std::shared_ptr< ::grpc::ChannelInterface> channel_;
+    const ::grpc::internal::RpcMethod rpcmethod_Send_;
+  };
+  static std::unique_ptr<Stub> NewStub(const std::shared_ptr< ::grpc::ChannelInterface>& channel, const ::grpc::StubOptions& options = ::grpc::StubOptions());
+  class Service : public ::grpc::Service {
+   public:
+    Service();
+    virtual ~Service();
+    virtual ::grpc::Status Send(::grpc::ServerContext* context, const ::comms::PacketBundle* request, ::comms::PacketResponse* response);
+  };
+  template <class BaseClass>
+  class WithAsyncMethod_Send : public BaseClass {
+   public:
+    WithAsyncMethod_Send() { ::grpc::Service::MarkMethodAsync(0); }
+    ::grpc::Status Send(::grpc::ServerContext*, const ::comms::PacketBundle*, ::comms::PacketResponse*) override { abort(); }
+    void RequestSend(::grpc::ServerContext* context, ::comms::PacketBundle* request, ::grpc::ServerAsyncResponseWriter< ::comms::PacketResponse>* response, ::grpc::CompletionQueue* new_call_cq, ::grpc::ServerCompletionQueue* notification_cq, void *tag) {
+      ::grpc::Service::RequestAsyncUnary(0, context, request, response, new_call_cq, notification_cq, tag);
+    }
+  };
+  typedef WithAsyncMethod_Send<Service > AsyncService;
+};
+}  // namespace
+
@@ -12,7 +12,30 @@
 */
 
 #define COMMS_SUCCESS           0
-#define COMMS_NOT_SCHEDULED     1
+#define COMMS_NOT_SCHEDULED     1   // reap: destination queue was backed up, not sent
+#define COMMS_NOT_DELIVERED     2   // reap: RPC failed with a non-retryable error
+#define COMMS_UNAVAILABLE       3   // reap: peer unreachable, retries exhausted
+#define COMMS_DEADLINE_EXCEEDED 4   // reap: RPC deadline expired, retries exhausted
+#define COMMS_RESOURCE_EXHAUSTED 5  // reap: peer out of resources, retries exhausted
+#define COMMS_PEER_UNAVAILABLE  6   // reap: circuit breaker open, not sent
+#define COMMS_DUPLICATE         7   // reap: delivered by an earlier attempt, this copy was dropped
+#define COMMS_PEER_REMOVED      8   // reap: end point was removed, not sent
+#define COMMS_NOT_DRAINED       9   // reap: comms shut down before it was sent
+
+#define COMMS_PAYLOAD_RECYCLE   1   // payload: returned to the pool when its packet is reaped
+
+#define COMMS_DTYPE_INT32       0   // collective: element types
+#define COMMS_DTYPE_INT64       1
+#define COMMS_DTYPE_FLOAT32     2
+#define COMMS_DTYPE_FLOAT64     3
+
+#define COMMS_OP_SUM            0   // collective: reduction operators
+#define COMMS_OP_MIN            1
+#define COMMS_OP_MAX            2
+
+#define COMMS_BREAKER_CLOSED    0   // health: peer is healthy
+#define COMMS_BREAKER_OPEN      1   // health: peer is failing fast
+#define COMMS_BREAKER_HALF_OPEN 2   // health: probe succeeded, one trial bundle allowed
 
 typedef struct comms_end_point_t {
     char *name;
@@ -37,6 +60,39 @@ typedef struct comms_catch_header_t {
     uint64_t opaque;
 } comms_catch_header_t;
 
+typedef struct comms_end_point_health_t {
+    uint32_t state;
+    uint32_t consecutive_failures;
+    uint64_t latency_us;
+    uint64_t success_count;
+    uint64_t failure_count;
+} comms_end_point_health_t;
+
+typedef struct comms_stats_t {
+    // Counters, summed over the selected end points and lanes.
+    uint64_t submitted_packets;
+    uint64_t submitted_bytes;
+    uint64_t transmitted_packets;
+    uint64_t transmitted_bytes;
+    uint64_t retried_packets;
+    uint64_t failed_packets;
+    uint64_t caught_packets;
+    uint64_t released_packets;
+
+    // Queue depths, sampled when the stats are read.
+    uint64_t submit_queue_depth;
+    uint64_t catch_queue_depth;
+    uint64_t reap_queue_depth;
+
+    // Latency percentiles in microseconds, across all end points and lanes.
+    uint64_t transmit_latency_p50_us;
+    uint64_t transmit_latency_p99_us;
+    uint64_t transmit_latency_max_us;
+    uint64_t reap_latency_p50_us;
+    uint64_t reap_latency_p99_us;
+    uint64_t reap_latency_max_us;
+} comms_stats_t;
+
 typedef struct comms_packet_t {
     union {
         comms_submit_header_t submit;
@@ -48,13 +104,40 @@ typedef struct comms_packet_t {
 } comms_packet_t;
 
 typedef struct comms_t comms_t;
+
+// Supplies additional Prometheus text to the metrics endpoint, e.g.
+// sync_metrics_source(). The text is allocated with malloc and freed by comms.
+typedef int (*comms_metrics_source_t)(void *context, char **text, char **error);
+
 int comms_create(comms_t **C, comms_end_point_t *this_end_point, comms_end_point_t *end_point_list, size_t end_point_count, int lane_count, char **error);
 int comms_configure(comms_t *C, const char *key, const char *value, char **error);
 int comms_start(comms_t *C, char **error);
 int comms_wait_for_start(comms_t *C, double timeout, char **error);
 int comms_wait_for_shutdown(comms_t *C, double timeout, char **error);
 int comms_shutdown(comms_t *C, char **error);
+
+// Shuts comms down, in place of comms_shutdown, without losing submitted
+// packets: submits are refused from here on, every accessor is flushed and
+// the writers keep sending, retries included, until nothing is left or
+// timeout seconds have passed (0 for no limit). Packets still unsent then
+// are reaped with COMMS_NOT_DRAINED, and comms_drain fails saying how many
+// there were.
+int comms_drain(comms_t *C, double timeout, char **error);
 int comms_destroy(comms_t *C, char **error);
+int comms_end_point_health(comms_t *C, size_t end_point, comms_end_point_health_t *health, char **error);
+
+// Membership changes while comms runs, up to the end-point-capacity setting.
+// An added end point takes the next index, so processes applying the same
+// changes in the same order (e.g. from a discovery watch) agree on indices.
+// A removed end point keeps its index, which is not reused; packets still
+// bound for it are reaped with COMMS_PEER_REMOVED.
+int comms_add_end_point(comms_t *C, comms_end_point_t *end_point, size_t *index, char **error);
+int comms_remove_end_point(comms_t *C, size_t index, char **error);
+int comms_stats(comms_t *C, int end_point, int lane, comms_stats_t *stats, char **error);
+int comms_stats_json(comms_t *C, char **json, char **error);
+int comms_trace_dump(comms_t *C, const char *path, char **error);
+int comms_metrics_text(comms_t *C, char **text, char **error);
+int comms_metrics_add_source(comms_t *C, comms_metrics_source_t source, void *context, char **error);
 
 typedef struct comms_accessor_t comms_accessor_t;
 int comms_accessor_create(comms_accessor_t **A, comms_t *C, int lane, char **error);
@@ -65,6 +148,44 @@ int comms_reap   (comms_accessor_t *A, comms_packet_t packet_list[], size_t pack
 int comms_catch  (comms_accessor_t *A, comms_packet_t packet_list[], size_t packet_count, char **error);
 int comms_release(comms_accessor_t *A, comms_packet_t packet_list[], size_t packet_count, char **error);
 
+// Catches only packets whose tag matches tag in the bits set in mask (all
+// ones for an exact tag, 0 for any packet). Packets caught on the way that
+// don't match are kept by comms, in arrival order per tag, for later
+// catches (matching or not) by any accessor sharing the catch queue.
+int comms_catch_matching(comms_accessor_t *A, uint64_t tag, uint64_t mask,
+                         comms_packet_t packet_list[], size_t packet_count, char **error);
+
 int comms_submit_flush(comms_accessor_t *A, char **error);
 
+// Payload buffers from the accessor's own pool, for use on the accessor's
+// thread. With COMMS_PAYLOAD_RECYCLE the buffer goes back to the pool when
+// comms_reap hands back its packet, whatever the reap code, and the reaped
+// packet's payload is set to NULL; otherwise it is returned with
+// comms_payload_free. Buffers left over are freed with the accessor.
+int comms_payload_alloc(comms_accessor_t *A, size_t size, int flags, uint8_t **payload, char **error);
+int comms_payload_free(comms_accessor_t *A, uint8_t *payload, char **error);
+
+// Sends every packet to each of the dst_count end points in dst_list (all end
+// points if dst_list is NULL); submit.dst is ignored. Payloads are encoded
+// once for all destinations and each packet is reaped once, with the first
+// failure seen across the destinations.
+int comms_submit_broadcast(comms_accessor_t *A, comms_packet_t packet_list[], size_t packet_count,
+                           const uint32_t dst_list[], size_t dst_count, char **error);
+
+// Collective operations among all end points, ranked by their index in the
+// end point list. They run on an exclusive lane (see the exclusive-lanes
+// setting) so their packets never reach comms_catch on other lanes. Every
+// end point must issue the same collectives in the same order, and a
+// collective object is used by one thread at a time. The ranks are those
+// at creation: creating one fails while any end point is removed, and its
+// operations fail once an end point has been added or removed since.
+typedef struct comms_collective_t comms_collective_t;
+int comms_collective_create(comms_collective_t **G, comms_t *C, int lane, char **error);
+int comms_collective_destroy(comms_collective_t *G, char **error);
+
+int comms_collective_broadcast(comms_collective_t *G, void *buffer, size_t size, uint32_t root, char **error);
+int comms_collective_gather   (comms_collective_t *G, const void *send, size_t size, void *recv, uint32_t root, char **error);
+int comms_collective_scatter  (comms_collective_t *G, const void *send, size_t size, void *recv, uint32_t root, char **error);
+int comms_collective_allreduce(comms_collective_t *G, const void *send, void *recv, size_t count, int dtype, int op, char **error);
+
 #endif // __COMMS_H_
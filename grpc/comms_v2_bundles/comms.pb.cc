@@ -0,0 +1,1048 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+// source: comms.proto
+
+#include "comms.pb.h"
+
+#include <algorithm>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/extension_set.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+// @@protoc_insertion_point(includes)
+#include <google/protobuf/port_def.inc>
+
+PROTOBUF_PRAGMA_INIT_SEG
+
+namespace _pb = ::PROTOBUF_NAMESPACE_ID;
+namespace _pbi = _pb::internal;
+
+namespace comms {
+PROTOBUF_CONSTEXPR Packet::Packet(
+    ::_pbi::ConstantInitialized): _impl_{
+    /*decltype(_impl_.payload_)*/{&::_pbi::fixed_address_empty_string, ::_pbi::ConstantInitialized{}}
+  , /*decltype(_impl_.tag_)*/uint64_t{0u}
+  , /*decltype(_impl_.src_)*/0
+  , /*decltype(_impl_.size_)*/0u
+  , /*decltype(_impl_._cached_size_)*/{}} {}
+struct PacketDefaultTypeInternal {
+  PROTOBUF_CONSTEXPR PacketDefaultTypeInternal()
+      : _instance(::_pbi::ConstantInitialized{}) {}
+  ~PacketDefaultTypeInternal() {}
+  union {
+    Packet _instance;
+  };
+};
+PROTOBUF_ATTRIBUTE_NO_DESTROY PROTOBUF_CONSTINIT PROTOBUF_ATTRIBUTE_INIT_PRIORITY1 PacketDefaultTypeInternal _Packet_default_instance_;
+PROTOBUF_CONSTEXPR PacketBundle::PacketBundle(
+    ::_pbi::ConstantInitialized): _impl_{
+    /*decltype(_impl_.packet_)*/{}
+  , /*decltype(_impl_.trace_)*/{}
+  , /*decltype(_impl_._trace_cached_byte_size_)*/{0}
+  , /*decltype(_impl_.block_)*/{&::_pbi::fixed_address_empty_string, ::_pbi::ConstantInitialized{}}
+  , /*decltype(_impl_.lane_)*/0
+  , /*decltype(_impl_.src_)*/0
+  , /*decltype(_impl_.codec_)*/0u
+  , /*decltype(_impl_.block_size_)*/0u
+  , /*decltype(_impl_.sequence_)*/uint64_t{0u}
+  , /*decltype(_impl_.epoch_)*/uint64_t{0u}
+  , /*decltype(_impl_.bundle_id_)*/uint64_t{0u}
+  , /*decltype(_impl_._cached_size_)*/{}} {}
+struct PacketBundleDefaultTypeInternal {
+  PROTOBUF_CONSTEXPR PacketBundleDefaultTypeInternal()
+      : _instance(::_pbi::ConstantInitialized{}) {}
+  ~PacketBundleDefaultTypeInternal() {}
+  union {
+    PacketBundle _instance;
+  };
+};
+PROTOBUF_ATTRIBUTE_NO_DESTROY PROTOBUF_CONSTINIT PROTOBUF_ATTRIBUTE_INIT_PRIORITY1 PacketBundleDefaultTypeInternal _PacketBundle_default_instance_;
+PROTOBUF_CONSTEXPR PacketResponse::PacketResponse(
+    ::_pbi::ConstantInitialized): _impl_{
+    /*decltype(_impl_.credit_limit_)*/uint64_t{0u}
+  , /*decltype(_impl_.duplicate_)*/false
+  , /*decltype(_impl_._cached_size_)*/{}} {}
+struct PacketResponseDefaultTypeInternal {
+  PROTOBUF_CONSTEXPR PacketResponseDefaultTypeInternal()
+      : _instance(::_pbi::ConstantInitialized{}) {}
+  ~PacketResponseDefaultTypeInternal() {}
+  union {
+    PacketResponse _instance;
+  };
+};
+PROTOBUF_ATTRIBUTE_NO_DESTROY PROTOBUF_CONSTINIT PROTOBUF_ATTRIBUTE_INIT_PRIORITY1 PacketResponseDefaultTypeInternal _PacketResponse_default_instance_;
+}  // namespace comms
+namespace comms {
+
+// ===================================================================
+
+class Packet::_Internal {
+ public:
+};
+
+Packet::Packet(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                         bool is_message_owned)
+  : ::PROTOBUF_NAMESPACE_ID::MessageLite(arena, is_message_owned) {
+  SharedCtor(arena, is_message_owned);
+  // @@protoc_insertion_point(arena_constructor:comms.Packet)
+}
+Packet::Packet(const Packet& from)
+  : ::PROTOBUF_NAMESPACE_ID::MessageLite() {
+  Packet* const _this = this; (void)_this;
+  new (&_impl_) Impl_{
+      decltype(_impl_.payload_){}
+    , decltype(_impl_.tag_){}
+    , decltype(_impl_.src_){}
+    , decltype(_impl_.size_){}
+    , /*decltype(_impl_._cached_size_)*/{}};
+
+  _internal_metadata_.MergeFrom<std::string>(from._internal_metadata_);
+  _impl_.payload_.InitDefault();
+  #ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+    _impl_.payload_.Set("", GetArenaForAllocation());
+  #endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (!from._internal_payload().empty()) {
+    _this->_impl_.payload_.Set(from._internal_payload(), 
+      _this->GetArenaForAllocation());
+  }
+  ::memcpy(&_impl_.tag_, &from._impl_.tag_,
+    static_cast<size_t>(reinterpret_cast<char*>(&_impl_.size_) -
+    reinterpret_cast<char*>(&_impl_.tag_)) + sizeof(_impl_.size_));
+  // @@protoc_insertion_point(copy_constructor:comms.Packet)
+}
+
+inline void Packet::SharedCtor(
+    ::_pb::Arena* arena, bool is_message_owned) {
+  (void)arena;
+  (void)is_message_owned;
+  new (&_impl_) Impl_{
+      decltype(_impl_.payload_){}
+    , decltype(_impl_.tag_){uint64_t{0u}}
+    , decltype(_impl_.src_){0}
+    , decltype(_impl_.size_){0u}
+    , /*decltype(_impl_._cached_size_)*/{}
+  };
+  _impl_.payload_.InitDefault();
+  #ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+    _impl_.payload_.Set("", GetArenaForAllocation());
+  #endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+}
+
+Packet::~Packet() {
+  // @@protoc_insertion_point(destructor:comms.Packet)
+  if (auto *arena = _internal_metadata_.DeleteReturnArena<std::string>()) {
+  (void)arena;
+    return;
+  }
+  SharedDtor();
+}
+
+inline void Packet::SharedDtor() {
+  GOOGLE_DCHECK(GetArenaForAllocation() == nullptr);
+  _impl_.payload_.Destroy();
+}
+
+void Packet::SetCachedSize(int size) const {
+  _impl_._cached_size_.Set(size);
+}
+
+void Packet::Clear() {
+// @@protoc_insertion_point(message_clear_start:comms.Packet)
+  uint32_t cached_has_bits = 0;
+  // Prevent compiler warnings about cached_has_bits being unused
+  (void) cached_has_bits;
+
+  _impl_.payload_.ClearToEmpty();
+  ::memset(&_impl_.tag_, 0, static_cast<size_t>(
+      reinterpret_cast<char*>(&_impl_.size_) -
+      reinterpret_cast<char*>(&_impl_.tag_)) + sizeof(_impl_.size_));
+  _internal_metadata_.Clear<std::string>();
+}
+
+const char* Packet::_InternalParse(const char* ptr, ::_pbi::ParseContext* ctx) {
+#define CHK_(x) if (PROTOBUF_PREDICT_FALSE(!(x))) goto failure
+  while (!ctx->Done(&ptr)) {
+    uint32_t tag;
+    ptr = ::_pbi::ReadTag(ptr, &tag);
+    switch (tag >> 3) {
+      // int32 src = 1;
+      case 1:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 8)) {
+          _impl_.src_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint64 tag = 2;
+      case 2:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 16)) {
+          _impl_.tag_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // bytes payload = 3;
+      case 3:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 26)) {
+          auto str = _internal_mutable_payload();
+          ptr = ::_pbi::InlineGreedyStringParser(str, ptr, ctx);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint32 size = 4;
+      case 4:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 32)) {
+          _impl_.size_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      default:
+        goto handle_unusual;
+    }  // switch
+  handle_unusual:
+    if ((tag == 0) || ((tag & 7) == 4)) {
+      CHK_(ptr);
+      ctx->SetLastTag(tag);
+      goto message_done;
+    }
+    ptr = UnknownFieldParse(
+        tag,
+        _internal_metadata_.mutable_unknown_fields<std::string>(),
+        ptr, ctx);
+    CHK_(ptr != nullptr);
+  }  // while
+message_done:
+  return ptr;
+failure:
+  ptr = nullptr;
+  goto message_done;
+#undef CHK_
+}
+
+uint8_t* Packet::_InternalSerialize(
+    uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const {
+  // @@protoc_insertion_point(serialize_to_array_start:comms.Packet)
+  uint32_t cached_has_bits = 0;
+  (void) cached_has_bits;
+
+  // int32 src = 1;
+  if (this->_internal_src() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteInt32ToArray(1, this->_internal_src(), target);
+  }
+
+  // uint64 tag = 2;
+  if (this->_internal_tag() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteUInt64ToArray(2, this->_internal_tag(), target);
+  }
+
+  // bytes payload = 3;
+  if (!this->_internal_payload().empty()) {
+    target = stream->WriteBytesMaybeAliased(
+        3, this->_internal_payload(), target);
+  }
+
+  // uint32 size = 4;
+  if (this->_internal_size() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteUInt32ToArray(4, this->_internal_size(), target);
+  }
+
+  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
+    target = stream->WriteRaw(_internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString).data(),
+        static_cast<int>(_internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString).size()), target);
+  }
+  // @@protoc_insertion_point(serialize_to_array_end:comms.Packet)
+  return target;
+}
+
+size_t Packet::ByteSizeLong() const {
+// @@protoc_insertion_point(message_byte_size_start:comms.Packet)
+  size_t total_size = 0;
+
+  uint32_t cached_has_bits = 0;
+  // Prevent compiler warnings about cached_has_bits being unused
+  (void) cached_has_bits;
+
+  // bytes payload = 3;
+  if (!this->_internal_payload().empty()) {
+    total_size += 1 +
+      ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::BytesSize(
+        this->_internal_payload());
+  }
+
+  // uint64 tag = 2;
+  if (this->_internal_tag() != 0) {
+    total_size += ::_pbi::WireFormatLite::UInt64SizePlusOne(this->_internal_tag());
+  }
+
+  // int32 src = 1;
+  if (this->_internal_src() != 0) {
+    total_size += ::_pbi::WireFormatLite::Int32SizePlusOne(this->_internal_src());
+  }
+
+  // uint32 size = 4;
+  if (this->_internal_size() != 0) {
+    total_size += ::_pbi::WireFormatLite::UInt32SizePlusOne(this->_internal_size());
+  }
+
+  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
+    total_size += _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString).size();
+  }
+  int cached_size = ::_pbi::ToCachedSize(total_size);
+  SetCachedSize(cached_size);
+  return total_size;
+}
+
+void Packet::CheckTypeAndMergeFrom(
+    const ::PROTOBUF_NAMESPACE_ID::MessageLite& from) {
+  MergeFrom(*::_pbi::DownCast<const Packet*>(
+      &from));
+}
+
+void Packet::MergeFrom(const Packet& from) {
+  Packet* const _this = this;
+  // @@protoc_insertion_point(class_specific_merge_from_start:comms.Packet)
+  GOOGLE_DCHECK_NE(&from, _this);
+  uint32_t cached_has_bits = 0;
+  (void) cached_has_bits;
+
+  if (!from._internal_payload().empty()) {
+    _this->_internal_set_payload(from._internal_payload());
+  }
+  if (from._internal_tag() != 0) {
+    _this->_internal_set_tag(from._internal_tag());
+  }
+  if (from._internal_src() != 0) {
+    _this->_internal_set_src(from._internal_src());
+  }
+  if (from._internal_size() != 0) {
+    _this->_internal_set_size(from._internal_size());
+  }
+  _this->_internal_metadata_.MergeFrom<std::string>(from._internal_metadata_);
+}
+
+void Packet::CopyFrom(const Packet& from) {
+// @@protoc_insertion_point(class_specific_copy_from_start:comms.Packet)
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+bool Packet::IsInitialized() const {
+  return true;
+}
+
+void Packet::InternalSwap(Packet* other) {
+  using std::swap;
+  auto* lhs_arena = GetArenaForAllocation();
+  auto* rhs_arena = other->GetArenaForAllocation();
+  _internal_metadata_.InternalSwap(&other->_internal_metadata_);
+  ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr::InternalSwap(
+      &_impl_.payload_, lhs_arena,
+      &other->_impl_.payload_, rhs_arena
+  );
+  ::PROTOBUF_NAMESPACE_ID::internal::memswap<
+      PROTOBUF_FIELD_OFFSET(Packet, _impl_.size_)
+      + sizeof(Packet::_impl_.size_)
+      - PROTOBUF_FIELD_OFFSET(Packet, _impl_.tag_)>(
+          reinterpret_cast<char*>(&_impl_.tag_),
+          reinterpret_cast<char*>(&other->_impl_.tag_));
+}
+
+std::string Packet::GetTypeName() const {
+  return "comms.Packet";
+}
+
+
+// ===================================================================
+
+class PacketBundle::_Internal {
+ public:
+};
+
+PacketBundle::PacketBundle(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                         bool is_message_owned)
+  : ::PROTOBUF_NAMESPACE_ID::MessageLite(arena, is_message_owned) {
+  SharedCtor(arena, is_message_owned);
+  // @@protoc_insertion_point(arena_constructor:comms.PacketBundle)
+}
+PacketBundle::PacketBundle(const PacketBundle& from)
+  : ::PROTOBUF_NAMESPACE_ID::MessageLite() {
+  PacketBundle* const _this = this; (void)_this;
+  new (&_impl_) Impl_{
+      decltype(_impl_.packet_){from._impl_.packet_}
+    , decltype(_impl_.trace_){from._impl_.trace_}
+    , /*decltype(_impl_._trace_cached_byte_size_)*/{0}
+    , decltype(_impl_.block_){}
+    , decltype(_impl_.lane_){}
+    , decltype(_impl_.src_){}
+    , decltype(_impl_.codec_){}
+    , decltype(_impl_.block_size_){}
+    , decltype(_impl_.sequence_){}
+    , decltype(_impl_.epoch_){}
+    , decltype(_impl_.bundle_id_){}
+    , /*decltype(_impl_._cached_size_)*/{}};
+
+  _internal_metadata_.MergeFrom<std::string>(from._internal_metadata_);
+  _impl_.block_.InitDefault();
+  #ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+    _impl_.block_.Set("", GetArenaForAllocation());
+  #endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (!from._internal_block().empty()) {
+    _this->_impl_.block_.Set(from._internal_block(), 
+      _this->GetArenaForAllocation());
+  }
+  ::memcpy(&_impl_.lane_, &from._impl_.lane_,
+    static_cast<size_t>(reinterpret_cast<char*>(&_impl_.bundle_id_) -
+    reinterpret_cast<char*>(&_impl_.lane_)) + sizeof(_impl_.bundle_id_));
+  // @@protoc_insertion_point(copy_constructor:comms.PacketBundle)
+}
+
+inline void PacketBundle::SharedCtor(
+    ::_pb::Arena* arena, bool is_message_owned) {
+  (void)arena;
+  (void)is_message_owned;
+  new (&_impl_) Impl_{
+      decltype(_impl_.packet_){arena}
+    , decltype(_impl_.trace_){arena}
+    , /*decltype(_impl_._trace_cached_byte_size_)*/{0}
+    , decltype(_impl_.block_){}
+    , decltype(_impl_.lane_){0}
+    , decltype(_impl_.src_){0}
+    , decltype(_impl_.codec_){0u}
+    , decltype(_impl_.block_size_){0u}
+    , decltype(_impl_.sequence_){uint64_t{0u}}
+    , decltype(_impl_.epoch_){uint64_t{0u}}
+    , decltype(_impl_.bundle_id_){uint64_t{0u}}
+    , /*decltype(_impl_._cached_size_)*/{}
+  };
+  _impl_.block_.InitDefault();
+  #ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+    _impl_.block_.Set("", GetArenaForAllocation());
+  #endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+}
+
+PacketBundle::~PacketBundle() {
+  // @@protoc_insertion_point(destructor:comms.PacketBundle)
+  if (auto *arena = _internal_metadata_.DeleteReturnArena<std::string>()) {
+  (void)arena;
+    return;
+  }
+  SharedDtor();
+}
+
+inline void PacketBundle::SharedDtor() {
+  GOOGLE_DCHECK(GetArenaForAllocation() == nullptr);
+  _impl_.packet_.~RepeatedPtrField();
+  _impl_.trace_.~RepeatedField();
+  _impl_.block_.Destroy();
+}
+
+void PacketBundle::SetCachedSize(int size) const {
+  _impl_._cached_size_.Set(size);
+}
+
+void PacketBundle::Clear() {
+// @@protoc_insertion_point(message_clear_start:comms.PacketBundle)
+  uint32_t cached_has_bits = 0;
+  // Prevent compiler warnings about cached_has_bits being unused
+  (void) cached_has_bits;
+
+  _impl_.packet_.Clear();
+  _impl_.trace_.Clear();
+  _impl_.block_.ClearToEmpty();
+  ::memset(&_impl_.lane_, 0, static_cast<size_t>(
+      reinterpret_cast<char*>(&_impl_.bundle_id_) -
+      reinterpret_cast<char*>(&_impl_.lane_)) + sizeof(_impl_.bundle_id_));
+  _internal_metadata_.Clear<std::string>();
+}
+
+const char* PacketBundle::_InternalParse(const char* ptr, ::_pbi::ParseContext* ctx) {
+#define CHK_(x) if (PROTOBUF_PREDICT_FALSE(!(x))) goto failure
+  while (!ctx->Done(&ptr)) {
+    uint32_t tag;
+    ptr = ::_pbi::ReadTag(ptr, &tag);
+    switch (tag >> 3) {
+      // int32 lane = 1;
+      case 1:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 8)) {
+          _impl_.lane_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // repeated .comms.Packet packet = 2;
+      case 2:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 18)) {
+          ptr -= 1;
+          do {
+            ptr += 1;
+            ptr = ctx->ParseMessage(_internal_add_packet(), ptr);
+            CHK_(ptr);
+            if (!ctx->DataAvailable(ptr)) break;
+          } while (::PROTOBUF_NAMESPACE_ID::internal::ExpectTag<18>(ptr));
+        } else
+          goto handle_unusual;
+        continue;
+      // int32 src = 3;
+      case 3:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 24)) {
+          _impl_.src_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // repeated uint32 trace = 4;
+      case 4:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 34)) {
+          ptr = ::PROTOBUF_NAMESPACE_ID::internal::PackedUInt32Parser(_internal_mutable_trace(), ptr, ctx);
+          CHK_(ptr);
+        } else if (static_cast<uint8_t>(tag) == 32) {
+          _internal_add_trace(::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr));
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint32 codec = 5;
+      case 5:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 40)) {
+          _impl_.codec_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // bytes block = 6;
+      case 6:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 50)) {
+          auto str = _internal_mutable_block();
+          ptr = ::_pbi::InlineGreedyStringParser(str, ptr, ctx);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint32 block_size = 7;
+      case 7:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 56)) {
+          _impl_.block_size_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint64 sequence = 8;
+      case 8:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 64)) {
+          _impl_.sequence_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint64 epoch = 9;
+      case 9:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 72)) {
+          _impl_.epoch_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint64 bundle_id = 10;
+      case 10:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 80)) {
+          _impl_.bundle_id_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      default:
+        goto handle_unusual;
+    }  // switch
+  handle_unusual:
+    if ((tag == 0) || ((tag & 7) == 4)) {
+      CHK_(ptr);
+      ctx->SetLastTag(tag);
+      goto message_done;
+    }
+    ptr = UnknownFieldParse(
+        tag,
+        _internal_metadata_.mutable_unknown_fields<std::string>(),
+        ptr, ctx);
+    CHK_(ptr != nullptr);
+  }  // while
+message_done:
+  return ptr;
+failure:
+  ptr = nullptr;
+  goto message_done;
+#undef CHK_
+}
+
+uint8_t* PacketBundle::_InternalSerialize(
+    uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const {
+  // @@protoc_insertion_point(serialize_to_array_start:comms.PacketBundle)
+  uint32_t cached_has_bits = 0;
+  (void) cached_has_bits;
+
+  // int32 lane = 1;
+  if (this->_internal_lane() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteInt32ToArray(1, this->_internal_lane(), target);
+  }
+
+  // repeated .comms.Packet packet = 2;
+  for (unsigned i = 0,
+      n = static_cast<unsigned>(this->_internal_packet_size()); i < n; i++) {
+    const auto& repfield = this->_internal_packet(i);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::
+        InternalWriteMessage(2, repfield, repfield.GetCachedSize(), target, stream);
+  }
+
+  // int32 src = 3;
+  if (this->_internal_src() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteInt32ToArray(3, this->_internal_src(), target);
+  }
+
+  // repeated uint32 trace = 4;
+  {
+    int byte_size = _impl_._trace_cached_byte_size_.load(std::memory_order_relaxed);
+    if (byte_size > 0) {
+      target = stream->WriteUInt32Packed(
+          4, _internal_trace(), byte_size, target);
+    }
+  }
+
+  // uint32 codec = 5;
+  if (this->_internal_codec() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteUInt32ToArray(5, this->_internal_codec(), target);
+  }
+
+  // bytes block = 6;
+  if (!this->_internal_block().empty()) {
+    target = stream->WriteBytesMaybeAliased(
+        6, this->_internal_block(), target);
+  }
+
+  // uint32 block_size = 7;
+  if (this->_internal_block_size() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteUInt32ToArray(7, this->_internal_block_size(), target);
+  }
+
+  // uint64 sequence = 8;
+  if (this->_internal_sequence() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteUInt64ToArray(8, this->_internal_sequence(), target);
+  }
+
+  // uint64 epoch = 9;
+  if (this->_internal_epoch() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteUInt64ToArray(9, this->_internal_epoch(), target);
+  }
+
+  // uint64 bundle_id = 10;
+  if (this->_internal_bundle_id() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteUInt64ToArray(10, this->_internal_bundle_id(), target);
+  }
+
+  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
+    target = stream->WriteRaw(_internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString).data(),
+        static_cast<int>(_internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString).size()), target);
+  }
+  // @@protoc_insertion_point(serialize_to_array_end:comms.PacketBundle)
+  return target;
+}
+
+size_t PacketBundle::ByteSizeLong() const {
+// @@protoc_insertion_point(message_byte_size_start:comms.PacketBundle)
+  size_t total_size = 0;
+
+  uint32_t cached_has_bits = 0;
+  // Prevent compiler warnings about cached_has_bits being unused
+  (void) cached_has_bits;
+
+  // repeated .comms.Packet packet = 2;
+  total_size += 1UL * this->_internal_packet_size();
+  for (const auto& msg : this->_impl_.packet_) {
+    total_size +=
+      ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::MessageSize(msg);
+  }
+
+  // repeated uint32 trace = 4;
+  {
+    size_t data_size = ::_pbi::WireFormatLite::
+      UInt32Size(this->_impl_.trace_);
+    if (data_size > 0) {
+      total_size += 1 +
+        ::_pbi::WireFormatLite::Int32Size(static_cast<int32_t>(data_size));
+    }
+    int cached_size = ::_pbi::ToCachedSize(data_size);
+    _impl_._trace_cached_byte_size_.store(cached_size,
+                                    std::memory_order_relaxed);
+    total_size += data_size;
+  }
+
+  // bytes block = 6;
+  if (!this->_internal_block().empty()) {
+    total_size += 1 +
+      ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::BytesSize(
+        this->_internal_block());
+  }
+
+  // int32 lane = 1;
+  if (this->_internal_lane() != 0) {
+    total_size += ::_pbi::WireFormatLite::Int32SizePlusOne(this->_internal_lane());
+  }
+
+  // int32 src = 3;
+  if (this->_internal_src() != 0) {
+    total_size += ::_pbi::WireFormatLite::Int32SizePlusOne(this->_internal_src());
+  }
+
+  // uint32 codec = 5;
+  if (this->_internal_codec() != 0) {
+    total_size += ::_pbi::WireFormatLite::UInt32SizePlusOne(this->_internal_codec());
+  }
+
+  // uint32 block_size = 7;
+  if (this->_internal_block_size() != 0) {
+    total_size += ::_pbi::WireFormatLite::UInt32SizePlusOne(this->_internal_block_size());
+  }
+
+  // uint64 sequence = 8;
+  if (this->_internal_sequence() != 0) {
+    total_size += ::_pbi::WireFormatLite::UInt64SizePlusOne(this->_internal_sequence());
+  }
+
+  // uint64 epoch = 9;
+  if (this->_internal_epoch() != 0) {
+    total_size += ::_pbi::WireFormatLite::UInt64SizePlusOne(this->_internal_epoch());
+  }
+
+  // uint64 bundle_id = 10;
+  if (this->_internal_bundle_id() != 0) {
+    total_size += ::_pbi::WireFormatLite::UInt64SizePlusOne(this->_internal_bundle_id());
+  }
+
+  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
+    total_size += _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString).size();
+  }
+  int cached_size = ::_pbi::ToCachedSize(total_size);
+  SetCachedSize(cached_size);
+  return total_size;
+}
+
+void PacketBundle::CheckTypeAndMergeFrom(
+    const ::PROTOBUF_NAMESPACE_ID::MessageLite& from) {
+  MergeFrom(*::_pbi::DownCast<const PacketBundle*>(
+      &from));
+}
+
+void PacketBundle::MergeFrom(const PacketBundle& from) {
+  PacketBundle* const _this = this;
+  // @@protoc_insertion_point(class_specific_merge_from_start:comms.PacketBundle)
+  GOOGLE_DCHECK_NE(&from, _this);
+  uint32_t cached_has_bits = 0;
+  (void) cached_has_bits;
+
+  _this->_impl_.packet_.MergeFrom(from._impl_.packet_);
+  _this->_impl_.trace_.MergeFrom(from._impl_.trace_);
+  if (!from._internal_block().empty()) {
+    _this->_internal_set_block(from._internal_block());
+  }
+  if (from._internal_lane() != 0) {
+    _this->_internal_set_lane(from._internal_lane());
+  }
+  if (from._internal_src() != 0) {
+    _this->_internal_set_src(from._internal_src());
+  }
+  if (from._internal_codec() != 0) {
+    _this->_internal_set_codec(from._internal_codec());
+  }
+  if (from._internal_block_size() != 0) {
+    _this->_internal_set_block_size(from._internal_block_size());
+  }
+  if (from._internal_sequence() != 0) {
+    _this->_internal_set_sequence(from._internal_sequence());
+  }
+  if (from._internal_epoch() != 0) {
+    _this->_internal_set_epoch(from._internal_epoch());
+  }
+  if (from._internal_bundle_id() != 0) {
+    _this->_internal_set_bundle_id(from._internal_bundle_id());
+  }
+  _this->_internal_metadata_.MergeFrom<std::string>(from._internal_metadata_);
+}
+
+void PacketBundle::CopyFrom(const PacketBundle& from) {
+// @@protoc_insertion_point(class_specific_copy_from_start:comms.PacketBundle)
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+bool PacketBundle::IsInitialized() const {
+  return true;
+}
+
+void PacketBundle::InternalSwap(PacketBundle* other) {
+  using std::swap;
+  auto* lhs_arena = GetArenaForAllocation();
+  auto* rhs_arena = other->GetArenaForAllocation();
+  _internal_metadata_.InternalSwap(&other->_internal_metadata_);
+  _impl_.packet_.InternalSwap(&other->_impl_.packet_);
+  _impl_.trace_.InternalSwap(&other->_impl_.trace_);
+  ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr::InternalSwap(
+      &_impl_.block_, lhs_arena,
+      &other->_impl_.block_, rhs_arena
+  );
+  ::PROTOBUF_NAMESPACE_ID::internal::memswap<
+      PROTOBUF_FIELD_OFFSET(PacketBundle, _impl_.bundle_id_)
+      + sizeof(PacketBundle::_impl_.bundle_id_)
+      - PROTOBUF_FIELD_OFFSET(PacketBundle, _impl_.lane_)>(
+          reinterpret_cast<char*>(&_impl_.lane_),
+          reinterpret_cast<char*>(&other->_impl_.lane_));
+}
+
+std::string PacketBundle::GetTypeName() const {
+  return "comms.PacketBundle";
+}
+
+
+// ===================================================================
+
+class PacketResponse::_Internal {
+ public:
+};
+
+PacketResponse::PacketResponse(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                         bool is_message_owned)
+  : ::PROTOBUF_NAMESPACE_ID::MessageLite(arena, is_message_owned) {
+  SharedCtor(arena, is_message_owned);
+  // @@protoc_insertion_point(arena_constructor:comms.PacketResponse)
+}
+PacketResponse::PacketResponse(const PacketResponse& from)
+  : ::PROTOBUF_NAMESPACE_ID::MessageLite() {
+  PacketResponse* const _this = this; (void)_this;
+  new (&_impl_) Impl_{
+      decltype(_impl_.credit_limit_){}
+    , decltype(_impl_.duplicate_){}
+    , /*decltype(_impl_._cached_size_)*/{}};
+
+  _internal_metadata_.MergeFrom<std::string>(from._internal_metadata_);
+  ::memcpy(&_impl_.credit_limit_, &from._impl_.credit_limit_,
+    static_cast<size_t>(reinterpret_cast<char*>(&_impl_.duplicate_) -
+    reinterpret_cast<char*>(&_impl_.credit_limit_)) + sizeof(_impl_.duplicate_));
+  // @@protoc_insertion_point(copy_constructor:comms.PacketResponse)
+}
+
+inline void PacketResponse::SharedCtor(
+    ::_pb::Arena* arena, bool is_message_owned) {
+  (void)arena;
+  (void)is_message_owned;
+  new (&_impl_) Impl_{
+      decltype(_impl_.credit_limit_){uint64_t{0u}}
+    , decltype(_impl_.duplicate_){false}
+    , /*decltype(_impl_._cached_size_)*/{}
+  };
+}
+
+PacketResponse::~PacketResponse() {
+  // @@protoc_insertion_point(destructor:comms.PacketResponse)
+  if (auto *arena = _internal_metadata_.DeleteReturnArena<std::string>()) {
+  (void)arena;
+    return;
+  }
+  SharedDtor();
+}
+
+inline void PacketResponse::SharedDtor() {
+  GOOGLE_DCHECK(GetArenaForAllocation() == nullptr);
+}
+
+void PacketResponse::SetCachedSize(int size) const {
+  _impl_._cached_size_.Set(size);
+}
+
+void PacketResponse::Clear() {
+// @@protoc_insertion_point(message_clear_start:comms.PacketResponse)
+  uint32_t cached_has_bits = 0;
+  // Prevent compiler warnings about cached_has_bits being unused
+  (void) cached_has_bits;
+
+  ::memset(&_impl_.credit_limit_, 0, static_cast<size_t>(
+      reinterpret_cast<char*>(&_impl_.duplicate_) -
+      reinterpret_cast<char*>(&_impl_.credit_limit_)) + sizeof(_impl_.duplicate_));
+  _internal_metadata_.Clear<std::string>();
+}
+
+const char* PacketResponse::_InternalParse(const char* ptr, ::_pbi::ParseContext* ctx) {
+#define CHK_(x) if (PROTOBUF_PREDICT_FALSE(!(x))) goto failure
+  while (!ctx->Done(&ptr)) {
+    uint32_t tag;
+    ptr = ::_pbi::ReadTag(ptr, &tag);
+    switch (tag >> 3) {
+      // uint64 credit_limit = 1;
+      case 1:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 8)) {
+          _impl_.credit_limit_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // bool duplicate = 2;
+      case 2:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 16)) {
+          _impl_.duplicate_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      default:
+        goto handle_unusual;
+    }  // switch
+  handle_unusual:
+    if ((tag == 0) || ((tag & 7) == 4)) {
+      CHK_(ptr);
+      ctx->SetLastTag(tag);
+      goto message_done;
+    }
+    ptr = UnknownFieldParse(
+        tag,
+        _internal_metadata_.mutable_unknown_fields<std::string>(),
+        ptr, ctx);
+    CHK_(ptr != nullptr);
+  }  // while
+message_done:
+  return ptr;
+failure:
+  ptr = nullptr;
+  goto message_done;
+#undef CHK_
+}
+
+uint8_t* PacketResponse::_InternalSerialize(
+    uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const {
+  // @@protoc_insertion_point(serialize_to_array_start:comms.PacketResponse)
+  uint32_t cached_has_bits = 0;
+  (void) cached_has_bits;
+
+  // uint64 credit_limit = 1;
+  if (this->_internal_credit_limit() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteUInt64ToArray(1, this->_internal_credit_limit(), target);
+  }
+
+  // bool duplicate = 2;
+  if (this->_internal_duplicate() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::_pbi::WireFormatLite::WriteBoolToArray(2, this->_internal_duplicate(), target);
+  }
+
+  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
+    target = stream->WriteRaw(_internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString).data(),
+        static_cast<int>(_internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString).size()), target);
+  }
+  // @@protoc_insertion_point(serialize_to_array_end:comms.PacketResponse)
+  return target;
+}
+
+size_t PacketResponse::ByteSizeLong() const {
+// @@protoc_insertion_point(message_byte_size_start:comms.PacketResponse)
+  size_t total_size = 0;
+
+  uint32_t cached_has_bits = 0;
+  // Prevent compiler warnings about cached_has_bits being unused
+  (void) cached_has_bits;
+
+  // uint64 credit_limit = 1;
+  if (this->_internal_credit_limit() != 0) {
+    total_size += ::_pbi::WireFormatLite::UInt64SizePlusOne(this->_internal_credit_limit());
+  }
+
+  // bool duplicate = 2;
+  if (this->_internal_duplicate() != 0) {
+    total_size += 1 + 1;
+  }
+
+  if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
+    total_size += _internal_metadata_.unknown_fields<std::string>(::PROTOBUF_NAMESPACE_ID::internal::GetEmptyString).size();
+  }
+  int cached_size = ::_pbi::ToCachedSize(total_size);
+  SetCachedSize(cached_size);
+  return total_size;
+}
+
+void PacketResponse::CheckTypeAndMergeFrom(
+    const ::PROTOBUF_NAMESPACE_ID::MessageLite& from) {
+  MergeFrom(*::_pbi::DownCast<const PacketResponse*>(
+      &from));
+}
+
+void PacketResponse::MergeFrom(const PacketResponse& from) {
+  PacketResponse* const _this = this;
+  // @@protoc_insertion_point(class_specific_merge_from_start:comms.PacketResponse)
+  GOOGLE_DCHECK_NE(&from, _this);
+  uint32_t cached_has_bits = 0;
+  (void) cached_has_bits;
+
+  if (from._internal_credit_limit() != 0) {
+    _this->_internal_set_credit_limit(from._internal_credit_limit());
+  }
+  if (from._internal_duplicate() != 0) {
+    _this->_internal_set_duplicate(from._internal_duplicate());
+  }
+  _this->_internal_metadata_.MergeFrom<std::string>(from._internal_metadata_);
+}
+
+void PacketResponse::CopyFrom(const PacketResponse& from) {
+// @@protoc_insertion_point(class_specific_copy_from_start:comms.PacketResponse)
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+bool PacketResponse::IsInitialized() const {
+  return true;
+}
+
+void PacketResponse::InternalSwap(PacketResponse* other) {
+  using std::swap;
+  _internal_metadata_.InternalSwap(&other->_internal_metadata_);
+  ::PROTOBUF_NAMESPACE_ID::internal::memswap<
+      PROTOBUF_FIELD_OFFSET(PacketResponse, _impl_.duplicate_)
+      + sizeof(PacketResponse::_impl_.duplicate_)
+      - PROTOBUF_FIELD_OFFSET(PacketResponse, _impl_.credit_limit_)>(
+          reinterpret_cast<char*>(&_impl_.credit_limit_),
+          reinterpret_cast<char*>(&other->_impl_.credit_limit_));
+}
+
+std::string PacketResponse::GetTypeName() const {
+  return "comms.PacketResponse";
+}
+
+
+// @@protoc_insertion_point(namespace_scope)
+}  // namespace comms
+PROTOBUF_NAMESPACE_OPEN
+template<> PROTOBUF_NOINLINE ::comms::Packet*
+Arena::CreateMaybeMessage< ::comms::Packet >(Arena* arena) {
+  return Arena::CreateMessageInternal< ::comms::Packet >(arena);
+}
+template<> PROTOBUF_NOINLINE ::comms::PacketBundle*
+Arena::CreateMaybeMessage< ::comms::PacketBundle >(Arena* arena) {
+  return Arena::CreateMessageInternal< ::comms::PacketBundle >(arena);
+}
+template<> PROTOBUF_NOINLINE ::comms::PacketResponse*
+Arena::CreateMaybeMessage< ::comms::PacketResponse >(Arena* arena) {
+  return Arena::CreateMessageInternal< ::comms::PacketResponse >(arena);
+}
+PROTOBUF_NAMESPACE_CLOSE
+
+// @@protoc_insertion_point(global_scope)
+#include <google/protobuf/port_undef.inc>
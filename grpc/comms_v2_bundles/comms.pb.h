@@ -0,0 +1,1089 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+// source: comms.proto
+
+#ifndef GOOGLE_PROTOBUF_INCLUDED_comms_2eproto
+#define GOOGLE_PROTOBUF_INCLUDED_comms_2eproto
+
+#include <limits>
+#include <string>
+
+#include <google/protobuf/port_def.inc>
+#if PROTOBUF_VERSION < 3021000
+#error This file was generated by a newer version of protoc which is
+#error incompatible with your Protocol Buffer headers. Please update
+#error your headers.
+#endif
+#if 3021012 < PROTOBUF_MIN_PROTOC_VERSION
+#error This file was generated by an older version of protoc which is
+#error incompatible with your Protocol Buffer headers. Please
+#error regenerate this file with a newer version of protoc.
+#endif
+
+#include <google/protobuf/port_undef.inc>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/arenastring.h>
+#include <google/protobuf/generated_message_util.h>
+#include <google/protobuf/metadata_lite.h>
+#include <google/protobuf/message_lite.h>
+#include <google/protobuf/repeated_field.h>  // IWYU pragma: export
+#include <google/protobuf/extension_set.h>  // IWYU pragma: export
+// @@protoc_insertion_point(includes)
+#include <google/protobuf/port_def.inc>
+#define PROTOBUF_INTERNAL_EXPORT_comms_2eproto
+PROTOBUF_NAMESPACE_OPEN
+namespace internal {
+class AnyMetadata;
+}  // namespace internal
+PROTOBUF_NAMESPACE_CLOSE
+
+// Internal implementation detail -- do not use these members.
+struct TableStruct_comms_2eproto {
+  static const uint32_t offsets[];
+};
+namespace comms {
+class Packet;
+struct PacketDefaultTypeInternal;
+extern PacketDefaultTypeInternal _Packet_default_instance_;
+class PacketBundle;
+struct PacketBundleDefaultTypeInternal;
+extern PacketBundleDefaultTypeInternal _PacketBundle_default_instance_;
+class PacketResponse;
+struct PacketResponseDefaultTypeInternal;
+extern PacketResponseDefaultTypeInternal _PacketResponse_default_instance_;
+}  // namespace comms
+PROTOBUF_NAMESPACE_OPEN
+template<> ::comms::Packet* Arena::CreateMaybeMessage<::comms::Packet>(Arena*);
+template<> ::comms::PacketBundle* Arena::CreateMaybeMessage<::comms::PacketBundle>(Arena*);
+template<> ::comms::PacketResponse* Arena::CreateMaybeMessage<::comms::PacketResponse>(Arena*);
+PROTOBUF_NAMESPACE_CLOSE
+namespace comms {
+
+// ===================================================================
+
+class Packet final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:comms.Packet) */ {
+ public:
+  inline Packet() : Packet(nullptr) {}
+  ~Packet() override;
+  explicit PROTOBUF_CONSTEXPR Packet(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  Packet(const Packet& from);
+  Packet(Packet&& from) noexcept
+    : Packet() {
+    *this = ::std::move(from);
+  }
+
+  inline Packet& operator=(const Packet& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline Packet& operator=(Packet&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  static const Packet& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const Packet* internal_default_instance() {
+    return reinterpret_cast<const Packet*>(
+               &_Packet_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    0;
+
+  friend void swap(Packet& a, Packet& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(Packet* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(Packet* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  Packet* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<Packet>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const Packet& from);
+  void MergeFrom(const Packet& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(Packet* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "comms.Packet";
+  }
+  protected:
+  explicit Packet(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kPayloadFieldNumber = 3,
+    kTagFieldNumber = 2,
+    kSrcFieldNumber = 1,
+    kSizeFieldNumber = 4,
+  };
+  // bytes payload = 3;
+  void clear_payload();
+  const std::string& payload() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_payload(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_payload();
+  PROTOBUF_NODISCARD std::string* release_payload();
+  void set_allocated_payload(std::string* payload);
+  private:
+  const std::string& _internal_payload() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_payload(const std::string& value);
+  std::string* _internal_mutable_payload();
+  public:
+
+  // uint64 tag = 2;
+  void clear_tag();
+  uint64_t tag() const;
+  void set_tag(uint64_t value);
+  private:
+  uint64_t _internal_tag() const;
+  void _internal_set_tag(uint64_t value);
+  public:
+
+  // int32 src = 1;
+  void clear_src();
+  int32_t src() const;
+  void set_src(int32_t value);
+  private:
+  int32_t _internal_src() const;
+  void _internal_set_src(int32_t value);
+  public:
+
+  // uint32 size = 4;
+  void clear_size();
+  uint32_t size() const;
+  void set_size(uint32_t value);
+  private:
+  uint32_t _internal_size() const;
+  void _internal_set_size(uint32_t value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:comms.Packet)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr payload_;
+    uint64_t tag_;
+    int32_t src_;
+    uint32_t size_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_comms_2eproto;
+};
+// -------------------------------------------------------------------
+
+class PacketBundle final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:comms.PacketBundle) */ {
+ public:
+  inline PacketBundle() : PacketBundle(nullptr) {}
+  ~PacketBundle() override;
+  explicit PROTOBUF_CONSTEXPR PacketBundle(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  PacketBundle(const PacketBundle& from);
+  PacketBundle(PacketBundle&& from) noexcept
+    : PacketBundle() {
+    *this = ::std::move(from);
+  }
+
+  inline PacketBundle& operator=(const PacketBundle& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline PacketBundle& operator=(PacketBundle&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  static const PacketBundle& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const PacketBundle* internal_default_instance() {
+    return reinterpret_cast<const PacketBundle*>(
+               &_PacketBundle_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    1;
+
+  friend void swap(PacketBundle& a, PacketBundle& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(PacketBundle* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(PacketBundle* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  PacketBundle* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<PacketBundle>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const PacketBundle& from);
+  void MergeFrom(const PacketBundle& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(PacketBundle* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "comms.PacketBundle";
+  }
+  protected:
+  explicit PacketBundle(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kPacketFieldNumber = 2,
+    kTraceFieldNumber = 4,
+    kBlockFieldNumber = 6,
+    kLaneFieldNumber = 1,
+    kSrcFieldNumber = 3,
+    kCodecFieldNumber = 5,
+    kBlockSizeFieldNumber = 7,
+    kSequenceFieldNumber = 8,
+    kEpochFieldNumber = 9,
+    kBundleIdFieldNumber = 10,
+  };
+  // repeated .comms.Packet packet = 2;
+  int packet_size() const;
+  private:
+  int _internal_packet_size() const;
+  public:
+  void clear_packet();
+  ::comms::Packet* mutable_packet(int index);
+  ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::comms::Packet >*
+      mutable_packet();
+  private:
+  const ::comms::Packet& _internal_packet(int index) const;
+  ::comms::Packet* _internal_add_packet();
+  public:
+  const ::comms::Packet& packet(int index) const;
+  ::comms::Packet* add_packet();
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::comms::Packet >&
+      packet() const;
+
+  // repeated uint32 trace = 4;
+  int trace_size() const;
+  private:
+  int _internal_trace_size() const;
+  public:
+  void clear_trace();
+  private:
+  uint32_t _internal_trace(int index) const;
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedField< uint32_t >&
+      _internal_trace() const;
+  void _internal_add_trace(uint32_t value);
+  ::PROTOBUF_NAMESPACE_ID::RepeatedField< uint32_t >*
+      _internal_mutable_trace();
+  public:
+  uint32_t trace(int index) const;
+  void set_trace(int index, uint32_t value);
+  void add_trace(uint32_t value);
+  const ::PROTOBUF_NAMESPACE_ID::RepeatedField< uint32_t >&
+      trace() const;
+  ::PROTOBUF_NAMESPACE_ID::RepeatedField< uint32_t >*
+      mutable_trace();
+
+  // bytes block = 6;
+  void clear_block();
+  const std::string& block() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_block(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_block();
+  PROTOBUF_NODISCARD std::string* release_block();
+  void set_allocated_block(std::string* block);
+  private:
+  const std::string& _internal_block() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_block(const std::string& value);
+  std::string* _internal_mutable_block();
+  public:
+
+  // int32 lane = 1;
+  void clear_lane();
+  int32_t lane() const;
+  void set_lane(int32_t value);
+  private:
+  int32_t _internal_lane() const;
+  void _internal_set_lane(int32_t value);
+  public:
+
+  // int32 src = 3;
+  void clear_src();
+  int32_t src() const;
+  void set_src(int32_t value);
+  private:
+  int32_t _internal_src() const;
+  void _internal_set_src(int32_t value);
+  public:
+
+  // uint32 codec = 5;
+  void clear_codec();
+  uint32_t codec() const;
+  void set_codec(uint32_t value);
+  private:
+  uint32_t _internal_codec() const;
+  void _internal_set_codec(uint32_t value);
+  public:
+
+  // uint32 block_size = 7;
+  void clear_block_size();
+  uint32_t block_size() const;
+  void set_block_size(uint32_t value);
+  private:
+  uint32_t _internal_block_size() const;
+  void _internal_set_block_size(uint32_t value);
+  public:
+
+  // uint64 sequence = 8;
+  void clear_sequence();
+  uint64_t sequence() const;
+  void set_sequence(uint64_t value);
+  private:
+  uint64_t _internal_sequence() const;
+  void _internal_set_sequence(uint64_t value);
+  public:
+
+  // uint64 epoch = 9;
+  void clear_epoch();
+  uint64_t epoch() const;
+  void set_epoch(uint64_t value);
+  private:
+  uint64_t _internal_epoch() const;
+  void _internal_set_epoch(uint64_t value);
+  public:
+
+  // uint64 bundle_id = 10;
+  void clear_bundle_id();
+  uint64_t bundle_id() const;
+  void set_bundle_id(uint64_t value);
+  private:
+  uint64_t _internal_bundle_id() const;
+  void _internal_set_bundle_id(uint64_t value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:comms.PacketBundle)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::comms::Packet > packet_;
+    ::PROTOBUF_NAMESPACE_ID::RepeatedField< uint32_t > trace_;
+    mutable std::atomic<int> _trace_cached_byte_size_;
+    ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr block_;
+    int32_t lane_;
+    int32_t src_;
+    uint32_t codec_;
+    uint32_t block_size_;
+    uint64_t sequence_;
+    uint64_t epoch_;
+    uint64_t bundle_id_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_comms_2eproto;
+};
+// -------------------------------------------------------------------
+
+class PacketResponse final :
+    public ::PROTOBUF_NAMESPACE_ID::MessageLite /* @@protoc_insertion_point(class_definition:comms.PacketResponse) */ {
+ public:
+  inline PacketResponse() : PacketResponse(nullptr) {}
+  ~PacketResponse() override;
+  explicit PROTOBUF_CONSTEXPR PacketResponse(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized);
+
+  PacketResponse(const PacketResponse& from);
+  PacketResponse(PacketResponse&& from) noexcept
+    : PacketResponse() {
+    *this = ::std::move(from);
+  }
+
+  inline PacketResponse& operator=(const PacketResponse& from) {
+    CopyFrom(from);
+    return *this;
+  }
+  inline PacketResponse& operator=(PacketResponse&& from) noexcept {
+    if (this == &from) return *this;
+    if (GetOwningArena() == from.GetOwningArena()
+  #ifdef PROTOBUF_FORCE_COPY_IN_MOVE
+        && GetOwningArena() != nullptr
+  #endif  // !PROTOBUF_FORCE_COPY_IN_MOVE
+    ) {
+      InternalSwap(&from);
+    } else {
+      CopyFrom(from);
+    }
+    return *this;
+  }
+
+  static const PacketResponse& default_instance() {
+    return *internal_default_instance();
+  }
+  static inline const PacketResponse* internal_default_instance() {
+    return reinterpret_cast<const PacketResponse*>(
+               &_PacketResponse_default_instance_);
+  }
+  static constexpr int kIndexInFileMessages =
+    2;
+
+  friend void swap(PacketResponse& a, PacketResponse& b) {
+    a.Swap(&b);
+  }
+  inline void Swap(PacketResponse* other) {
+    if (other == this) return;
+  #ifdef PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() != nullptr &&
+        GetOwningArena() == other->GetOwningArena()) {
+   #else  // PROTOBUF_FORCE_COPY_IN_SWAP
+    if (GetOwningArena() == other->GetOwningArena()) {
+  #endif  // !PROTOBUF_FORCE_COPY_IN_SWAP
+      InternalSwap(other);
+    } else {
+      ::PROTOBUF_NAMESPACE_ID::internal::GenericSwap(this, other);
+    }
+  }
+  void UnsafeArenaSwap(PacketResponse* other) {
+    if (other == this) return;
+    GOOGLE_DCHECK(GetOwningArena() == other->GetOwningArena());
+    InternalSwap(other);
+  }
+
+  // implements Message ----------------------------------------------
+
+  PacketResponse* New(::PROTOBUF_NAMESPACE_ID::Arena* arena = nullptr) const final {
+    return CreateMaybeMessage<PacketResponse>(arena);
+  }
+  void CheckTypeAndMergeFrom(const ::PROTOBUF_NAMESPACE_ID::MessageLite& from)  final;
+  void CopyFrom(const PacketResponse& from);
+  void MergeFrom(const PacketResponse& from);
+  PROTOBUF_ATTRIBUTE_REINITIALIZES void Clear() final;
+  bool IsInitialized() const final;
+
+  size_t ByteSizeLong() const final;
+  const char* _InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::internal::ParseContext* ctx) final;
+  uint8_t* _InternalSerialize(
+      uint8_t* target, ::PROTOBUF_NAMESPACE_ID::io::EpsCopyOutputStream* stream) const final;
+  int GetCachedSize() const final { return _impl_._cached_size_.Get(); }
+
+  private:
+  void SharedCtor(::PROTOBUF_NAMESPACE_ID::Arena* arena, bool is_message_owned);
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  void InternalSwap(PacketResponse* other);
+
+  private:
+  friend class ::PROTOBUF_NAMESPACE_ID::internal::AnyMetadata;
+  static ::PROTOBUF_NAMESPACE_ID::StringPiece FullMessageName() {
+    return "comms.PacketResponse";
+  }
+  protected:
+  explicit PacketResponse(::PROTOBUF_NAMESPACE_ID::Arena* arena,
+                       bool is_message_owned = false);
+  public:
+
+  std::string GetTypeName() const final;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  enum : int {
+    kCreditLimitFieldNumber = 1,
+    kDuplicateFieldNumber = 2,
+  };
+  // uint64 credit_limit = 1;
+  void clear_credit_limit();
+  uint64_t credit_limit() const;
+  void set_credit_limit(uint64_t value);
+  private:
+  uint64_t _internal_credit_limit() const;
+  void _internal_set_credit_limit(uint64_t value);
+  public:
+
+  // bool duplicate = 2;
+  void clear_duplicate();
+  bool duplicate() const;
+  void set_duplicate(bool value);
+  private:
+  bool _internal_duplicate() const;
+  void _internal_set_duplicate(bool value);
+  public:
+
+  // @@protoc_insertion_point(class_scope:comms.PacketResponse)
+ private:
+  class _Internal;
+
+  template <typename T> friend class ::PROTOBUF_NAMESPACE_ID::Arena::InternalHelper;
+  typedef void InternalArenaConstructable_;
+  typedef void DestructorSkippable_;
+  struct Impl_ {
+    uint64_t credit_limit_;
+    bool duplicate_;
+    mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
+  };
+  union { Impl_ _impl_; };
+  friend struct ::TableStruct_comms_2eproto;
+};
+// ===================================================================
+
+
+// ===================================================================
+
+#ifdef __GNUC__
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wstrict-aliasing"
+#endif  // __GNUC__
+// Packet
+
+// int32 src = 1;
+inline void Packet::clear_src() {
+  _impl_.src_ = 0;
+}
+inline int32_t Packet::_internal_src() const {
+  return _impl_.src_;
+}
+inline int32_t Packet::src() const {
+  // @@protoc_insertion_point(field_get:comms.Packet.src)
+  return _internal_src();
+}
+inline void Packet::_internal_set_src(int32_t value) {
+  
+  _impl_.src_ = value;
+}
+inline void Packet::set_src(int32_t value) {
+  _internal_set_src(value);
+  // @@protoc_insertion_point(field_set:comms.Packet.src)
+}
+
+// uint64 tag = 2;
+inline void Packet::clear_tag() {
+  _impl_.tag_ = uint64_t{0u};
+}
+inline uint64_t Packet::_internal_tag() const {
+  return _impl_.tag_;
+}
+inline uint64_t Packet::tag() const {
+  // @@protoc_insertion_point(field_get:comms.Packet.tag)
+  return _internal_tag();
+}
+inline void Packet::_internal_set_tag(uint64_t value) {
+  
+  _impl_.tag_ = value;
+}
+inline void Packet::set_tag(uint64_t value) {
+  _internal_set_tag(value);
+  // @@protoc_insertion_point(field_set:comms.Packet.tag)
+}
+
+// bytes payload = 3;
+inline void Packet::clear_payload() {
+  _impl_.payload_.ClearToEmpty();
+}
+inline const std::string& Packet::payload() const {
+  // @@protoc_insertion_point(field_get:comms.Packet.payload)
+  return _internal_payload();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void Packet::set_payload(ArgT0&& arg0, ArgT... args) {
+ 
+ _impl_.payload_.SetBytes(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:comms.Packet.payload)
+}
+inline std::string* Packet::mutable_payload() {
+  std::string* _s = _internal_mutable_payload();
+  // @@protoc_insertion_point(field_mutable:comms.Packet.payload)
+  return _s;
+}
+inline const std::string& Packet::_internal_payload() const {
+  return _impl_.payload_.Get();
+}
+inline void Packet::_internal_set_payload(const std::string& value) {
+  
+  _impl_.payload_.Set(value, GetArenaForAllocation());
+}
+inline std::string* Packet::_internal_mutable_payload() {
+  
+  return _impl_.payload_.Mutable(GetArenaForAllocation());
+}
+inline std::string* Packet::release_payload() {
+  // @@protoc_insertion_point(field_release:comms.Packet.payload)
+  return _impl_.payload_.Release();
+}
+inline void Packet::set_allocated_payload(std::string* payload) {
+  if (payload != nullptr) {
+    
+  } else {
+    
+  }
+  _impl_.payload_.SetAllocated(payload, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.payload_.IsDefault()) {
+    _impl_.payload_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:comms.Packet.payload)
+}
+
+// uint32 size = 4;
+inline void Packet::clear_size() {
+  _impl_.size_ = 0u;
+}
+inline uint32_t Packet::_internal_size() const {
+  return _impl_.size_;
+}
+inline uint32_t Packet::size() const {
+  // @@protoc_insertion_point(field_get:comms.Packet.size)
+  return _internal_size();
+}
+inline void Packet::_internal_set_size(uint32_t value) {
+  
+  _impl_.size_ = value;
+}
+inline void Packet::set_size(uint32_t value) {
+  _internal_set_size(value);
+  // @@protoc_insertion_point(field_set:comms.Packet.size)
+}
+
+// -------------------------------------------------------------------
+
+// PacketBundle
+
+// int32 lane = 1;
+inline void PacketBundle::clear_lane() {
+  _impl_.lane_ = 0;
+}
+inline int32_t PacketBundle::_internal_lane() const {
+  return _impl_.lane_;
+}
+inline int32_t PacketBundle::lane() const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.lane)
+  return _internal_lane();
+}
+inline void PacketBundle::_internal_set_lane(int32_t value) {
+  
+  _impl_.lane_ = value;
+}
+inline void PacketBundle::set_lane(int32_t value) {
+  _internal_set_lane(value);
+  // @@protoc_insertion_point(field_set:comms.PacketBundle.lane)
+}
+
+// repeated .comms.Packet packet = 2;
+inline int PacketBundle::_internal_packet_size() const {
+  return _impl_.packet_.size();
+}
+inline int PacketBundle::packet_size() const {
+  return _internal_packet_size();
+}
+inline void PacketBundle::clear_packet() {
+  _impl_.packet_.Clear();
+}
+inline ::comms::Packet* PacketBundle::mutable_packet(int index) {
+  // @@protoc_insertion_point(field_mutable:comms.PacketBundle.packet)
+  return _impl_.packet_.Mutable(index);
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::comms::Packet >*
+PacketBundle::mutable_packet() {
+  // @@protoc_insertion_point(field_mutable_list:comms.PacketBundle.packet)
+  return &_impl_.packet_;
+}
+inline const ::comms::Packet& PacketBundle::_internal_packet(int index) const {
+  return _impl_.packet_.Get(index);
+}
+inline const ::comms::Packet& PacketBundle::packet(int index) const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.packet)
+  return _internal_packet(index);
+}
+inline ::comms::Packet* PacketBundle::_internal_add_packet() {
+  return _impl_.packet_.Add();
+}
+inline ::comms::Packet* PacketBundle::add_packet() {
+  ::comms::Packet* _add = _internal_add_packet();
+  // @@protoc_insertion_point(field_add:comms.PacketBundle.packet)
+  return _add;
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedPtrField< ::comms::Packet >&
+PacketBundle::packet() const {
+  // @@protoc_insertion_point(field_list:comms.PacketBundle.packet)
+  return _impl_.packet_;
+}
+
+// int32 src = 3;
+inline void PacketBundle::clear_src() {
+  _impl_.src_ = 0;
+}
+inline int32_t PacketBundle::_internal_src() const {
+  return _impl_.src_;
+}
+inline int32_t PacketBundle::src() const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.src)
+  return _internal_src();
+}
+inline void PacketBundle::_internal_set_src(int32_t value) {
+  
+  _impl_.src_ = value;
+}
+inline void PacketBundle::set_src(int32_t value) {
+  _internal_set_src(value);
+  // @@protoc_insertion_point(field_set:comms.PacketBundle.src)
+}
+
+// repeated uint32 trace = 4;
+inline int PacketBundle::_internal_trace_size() const {
+  return _impl_.trace_.size();
+}
+inline int PacketBundle::trace_size() const {
+  return _internal_trace_size();
+}
+inline void PacketBundle::clear_trace() {
+  _impl_.trace_.Clear();
+}
+inline uint32_t PacketBundle::_internal_trace(int index) const {
+  return _impl_.trace_.Get(index);
+}
+inline uint32_t PacketBundle::trace(int index) const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.trace)
+  return _internal_trace(index);
+}
+inline void PacketBundle::set_trace(int index, uint32_t value) {
+  _impl_.trace_.Set(index, value);
+  // @@protoc_insertion_point(field_set:comms.PacketBundle.trace)
+}
+inline void PacketBundle::_internal_add_trace(uint32_t value) {
+  _impl_.trace_.Add(value);
+}
+inline void PacketBundle::add_trace(uint32_t value) {
+  _internal_add_trace(value);
+  // @@protoc_insertion_point(field_add:comms.PacketBundle.trace)
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedField< uint32_t >&
+PacketBundle::_internal_trace() const {
+  return _impl_.trace_;
+}
+inline const ::PROTOBUF_NAMESPACE_ID::RepeatedField< uint32_t >&
+PacketBundle::trace() const {
+  // @@protoc_insertion_point(field_list:comms.PacketBundle.trace)
+  return _internal_trace();
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedField< uint32_t >*
+PacketBundle::_internal_mutable_trace() {
+  return &_impl_.trace_;
+}
+inline ::PROTOBUF_NAMESPACE_ID::RepeatedField< uint32_t >*
+PacketBundle::mutable_trace() {
+  // @@protoc_insertion_point(field_mutable_list:comms.PacketBundle.trace)
+  return _internal_mutable_trace();
+}
+
+// uint32 codec = 5;
+inline void PacketBundle::clear_codec() {
+  _impl_.codec_ = 0u;
+}
+inline uint32_t PacketBundle::_internal_codec() const {
+  return _impl_.codec_;
+}
+inline uint32_t PacketBundle::codec() const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.codec)
+  return _internal_codec();
+}
+inline void PacketBundle::_internal_set_codec(uint32_t value) {
+  
+  _impl_.codec_ = value;
+}
+inline void PacketBundle::set_codec(uint32_t value) {
+  _internal_set_codec(value);
+  // @@protoc_insertion_point(field_set:comms.PacketBundle.codec)
+}
+
+// bytes block = 6;
+inline void PacketBundle::clear_block() {
+  _impl_.block_.ClearToEmpty();
+}
+inline const std::string& PacketBundle::block() const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.block)
+  return _internal_block();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void PacketBundle::set_block(ArgT0&& arg0, ArgT... args) {
+ 
+ _impl_.block_.SetBytes(static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:comms.PacketBundle.block)
+}
+inline std::string* PacketBundle::mutable_block() {
+  std::string* _s = _internal_mutable_block();
+  // @@protoc_insertion_point(field_mutable:comms.PacketBundle.block)
+  return _s;
+}
+inline const std::string& PacketBundle::_internal_block() const {
+  return _impl_.block_.Get();
+}
+inline void PacketBundle::_internal_set_block(const std::string& value) {
+  
+  _impl_.block_.Set(value, GetArenaForAllocation());
+}
+inline std::string* PacketBundle::_internal_mutable_block() {
+  
+  return _impl_.block_.Mutable(GetArenaForAllocation());
+}
+inline std::string* PacketBundle::release_block() {
+  // @@protoc_insertion_point(field_release:comms.PacketBundle.block)
+  return _impl_.block_.Release();
+}
+inline void PacketBundle::set_allocated_block(std::string* block) {
+  if (block != nullptr) {
+    
+  } else {
+    
+  }
+  _impl_.block_.SetAllocated(block, GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (_impl_.block_.IsDefault()) {
+    _impl_.block_.Set("", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:comms.PacketBundle.block)
+}
+
+// uint32 block_size = 7;
+inline void PacketBundle::clear_block_size() {
+  _impl_.block_size_ = 0u;
+}
+inline uint32_t PacketBundle::_internal_block_size() const {
+  return _impl_.block_size_;
+}
+inline uint32_t PacketBundle::block_size() const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.block_size)
+  return _internal_block_size();
+}
+inline void PacketBundle::_internal_set_block_size(uint32_t value) {
+  
+  _impl_.block_size_ = value;
+}
+inline void PacketBundle::set_block_size(uint32_t value) {
+  _internal_set_block_size(value);
+  // @@protoc_insertion_point(field_set:comms.PacketBundle.block_size)
+}
+
+// uint64 sequence = 8;
+inline void PacketBundle::clear_sequence() {
+  _impl_.sequence_ = uint64_t{0u};
+}
+inline uint64_t PacketBundle::_internal_sequence() const {
+  return _impl_.sequence_;
+}
+inline uint64_t PacketBundle::sequence() const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.sequence)
+  return _internal_sequence();
+}
+inline void PacketBundle::_internal_set_sequence(uint64_t value) {
+  
+  _impl_.sequence_ = value;
+}
+inline void PacketBundle::set_sequence(uint64_t value) {
+  _internal_set_sequence(value);
+  // @@protoc_insertion_point(field_set:comms.PacketBundle.sequence)
+}
+
+// uint64 epoch = 9;
+inline void PacketBundle::clear_epoch() {
+  _impl_.epoch_ = uint64_t{0u};
+}
+inline uint64_t PacketBundle::_internal_epoch() const {
+  return _impl_.epoch_;
+}
+inline uint64_t PacketBundle::epoch() const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.epoch)
+  return _internal_epoch();
+}
+inline void PacketBundle::_internal_set_epoch(uint64_t value) {
+  
+  _impl_.epoch_ = value;
+}
+inline void PacketBundle::set_epoch(uint64_t value) {
+  _internal_set_epoch(value);
+  // @@protoc_insertion_point(field_set:comms.PacketBundle.epoch)
+}
+
+// uint64 bundle_id = 10;
+inline void PacketBundle::clear_bundle_id() {
+  _impl_.bundle_id_ = uint64_t{0u};
+}
+inline uint64_t PacketBundle::_internal_bundle_id() const {
+  return _impl_.bundle_id_;
+}
+inline uint64_t PacketBundle::bundle_id() const {
+  // @@protoc_insertion_point(field_get:comms.PacketBundle.bundle_id)
+  return _internal_bundle_id();
+}
+inline void PacketBundle::_internal_set_bundle_id(uint64_t value) {
+  
+  _impl_.bundle_id_ = value;
+}
+inline void PacketBundle::set_bundle_id(uint64_t value) {
+  _internal_set_bundle_id(value);
+  // @@protoc_insertion_point(field_set:comms.PacketBundle.bundle_id)
+}
+
+// -------------------------------------------------------------------
+
+// PacketResponse
+
+// uint64 credit_limit = 1;
+inline void PacketResponse::clear_credit_limit() {
+  _impl_.credit_limit_ = uint64_t{0u};
+}
+inline uint64_t PacketResponse::_internal_credit_limit() const {
+  return _impl_.credit_limit_;
+}
+inline uint64_t PacketResponse::credit_limit() const {
+  // @@protoc_insertion_point(field_get:comms.PacketResponse.credit_limit)
+  return _internal_credit_limit();
+}
+inline void PacketResponse::_internal_set_credit_limit(uint64_t value) {
+  
+  _impl_.credit_limit_ = value;
+}
+inline void PacketResponse::set_credit_limit(uint64_t value) {
+  _internal_set_credit_limit(value);
+  // @@protoc_insertion_point(field_set:comms.PacketResponse.credit_limit)
+}
+
+// bool duplicate = 2;
+inline void PacketResponse::clear_duplicate() {
+  _impl_.duplicate_ = false;
+}
+inline bool PacketResponse::_internal_duplicate() const {
+  return _impl_.duplicate_;
+}
+inline bool PacketResponse::duplicate() const {
+  // @@protoc_insertion_point(field_get:comms.PacketResponse.duplicate)
+  return _internal_duplicate();
+}
+inline void PacketResponse::_internal_set_duplicate(bool value) {
+  
+  _impl_.duplicate_ = value;
+}
+inline void PacketResponse::set_duplicate(bool value) {
+  _internal_set_duplicate(value);
+  // @@protoc_insertion_point(field_set:comms.PacketResponse.duplicate)
+}
+
+#ifdef __GNUC__
+  #pragma GCC diagnostic pop
+#endif  // __GNUC__
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+
+
+// @@protoc_insertion_point(namespace_scope)
+
+}  // namespace comms
+
+// @@protoc_insertion_point(global_scope)
+
+#include <google/protobuf/port_undef.inc>
+#endif  // GOOGLE_PROTOBUF_INCLUDED_GOOGLE_PROTOBUF_INCLUDED_comms_2eproto
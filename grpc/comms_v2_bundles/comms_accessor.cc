@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 
 extern "C" {
@@ -7,103 +8,515 @@ extern "C" {
 
 #include <atomic>
 
+comms_accessor_rings_t::comms_accessor_rings_t(size_t submit_size,
+                                               size_t reap_size)
+        : writer_(0)
+        , submit_(submit_size)
+        , reap_(reap_size) {
+}
+
 comms_accessor_t::comms_accessor_t(comms_t *C, int lane)
         : C_(C)
         , lane_(lane)
-        , end_point_count_(C->end_points_.size())
-        , buffer_size_(COMMS_BUNDLE_SIZE)
-        , submit_bundles_(C->end_points_.size())
-        , reap_queue_(std::make_shared<moodycamel::ConcurrentQueue<comms_packet_t,CommsPacketTraits>>(1<<21))
-{}
+        , priority_(C->priority_lane(lane))
+        , ordered_(C->ordered_lane(lane))
+        , buffer_size_(priority_ ? C->conf_.priority_bundle_size : COMMS_BUNDLE_SIZE)
+        , submit_bundles_(C->conf_.end_point_capacity, nullptr)
+        , dirty_((C->conf_.end_point_capacity+63)/64, 0)
+        , partition_(C->conf_.end_point_capacity)
+        , reap_queue_(nullptr)
+        , rings_(nullptr)
+        , stats_(C->create_stats_shard())
+        , submitting_(false)
+{
+    // Packets are reaped by the thread creating the accessor, so its reap
+    // queue goes on that thread's NUMA node.
+    comms_numa_scope_t scope(comms_numa_local_node());
+    reap_queue_ = std::make_shared<PacketQueue>(1<<21);
+    // Priority bundles bypass the rings, which writers only visit in turn.
+    if (not priority_ and C->conf_.submit_ring_size > 0 and C->conf_.reap_ring_size > 0) {
+        rings_ = std::make_shared<comms_accessor_rings_t>(C->conf_.submit_ring_size, C->conf_.reap_ring_size);
+    }
+#ifdef COMMS_USE_TOKENS
+    reap_token_ = std::unique_ptr<moodycamel::ConsumerToken>(new moodycamel::ConsumerToken(*reap_queue_));
+#endif
+}
+
+// Unflushed packets are dropped along with their bundles.
+comms_accessor_t::~comms_accessor_t() {
+    for (comms_bundle_t *bundle : submit_bundles_) {
+        delete bundle;
+    }
+}
+
+comms_submit_scope_t::comms_submit_scope_t(comms_accessor_t *A)
+        : A_(A) {
+    A_->submitting_.store(true);
+}
+
+comms_submit_scope_t::~comms_submit_scope_t() {
+    A_->submitting_.store(false, std::memory_order_release);
+}
+
+bool comms_submit_scope_t::open() const {
+    return not A_->C_->draining_.load() and not A_->C_->shutting_down_;
+}
+
+// Each bundle is bound to a single destination so writers know where to
+// transmit it.
+comms_bundle_t& comms_accessor_t::submit_bundle(uint32_t dst) {
+    comms_bundle_t *bundle = submit_bundles_[dst];
+    if (bundle == nullptr) {
+        bundle = C_->bundle_pool_.acquire();
+        bundle->dst_ = dst;
+        bundle->lane_ = lane_;
+        submit_bundles_[dst] = bundle;
+    }
+    return *bundle;
+}
+
+static void comms_accessor_open_bundle(comms_accessor_t *A, comms_bundle_t& bundle) {
+    bundle.opened_at_ = comms_now_ns();
+    A->dirty_[bundle.dst()/64] |= uint64_t(1) << (bundle.dst()%64);
+}
+
+#ifdef COMMS_USE_TOKENS
+moodycamel::ProducerToken& comms_accessor_t::deposit_token(BundleQueue *queue) {
+    // End points share at most a couple of deposit queues.
+    for (auto& entry : deposit_tokens_) {
+        if (entry.first == queue) return *entry.second;
+    }
+    deposit_tokens_.emplace_back(queue, std::unique_ptr<moodycamel::ProducerToken>(new moodycamel::ProducerToken(*queue)));
+    return *deposit_tokens_.back().second;
+}
+#endif
 
 static void comms_accessor_submit_bundle(comms_accessor_t *A, EndPoint& end_point, comms_bundle_t& bundle) {
-    // Assign the reap queue to the opaque pointer for each packet in bundle.
-    comms_packet_t *packet_list = bundle.packet_list();
+    // Packets are reaped into the accessor's reap queue.
+    bundle.opaque_ = (void*)A->reap_queue_.get();
     size_t packet_count = bundle.size();
-    for (size_t index=0; index<packet_count; index++) {
-        packet_list[index].opaque = (void*)A->reap_queue_.get();
+
+    // Ordered lanes number bundles as they close, i.e. in submission order.
+    if (A->ordered_) {
+        bundle.sequence_ = end_point.next_sequence(bundle.lane());
+    }
+
+    if (bundle.trace_count_ > 0) {
+        A->C_->tracer_.stamp(bundle, COMMS_TRACE_BUNDLE_CLOSE);
     }
 
     // Buffer is full, submit the packets and set the return code based
     // on whether the deposit succeeded or failed.
-    bool ok = end_point.deposit_n(bundle);
+    // Bundles for the writers go through the accessor's own ring while it
+    // has room and fall back to the shared submit queue.
+    BundleQueue *queue = end_point.deposit_queue(A->priority_);
+    bool ok = false;
+    if (A->rings_ and queue == A->C_->submit_queue_.get()) {
+        ok = A->rings_->submit_.push(bundle);
+    }
+    if (not ok) {
+#ifdef COMMS_USE_TOKENS
+        ok = end_point.deposit_n(bundle, A->deposit_token(queue), A->priority_);
+#else
+        ok = end_point.deposit_n(bundle, A->priority_);
+#endif
+    }
+
+    if (packet_count > 0) {
+        A->stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_SUBMITTED_PACKETS, packet_count);
+        A->stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_SUBMITTED_BYTES, bundle.bytes_);
+    }
 
     // If the deposit failed, update return code and immediately place into
-    // reap queue.
+    // reap queue. Its sequence number is skipped.
     if (not ok) {
-        bundle.set_reap_rc(COMMS_NOT_SCHEDULED);
-
-        while (not A->reap_queue_->try_enqueue_bulk(packet_list, packet_count)) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
+        A->stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_FAILED_PACKETS, packet_count);
+        bundle.reap(COMMS_NOT_SCHEDULED);
+        A->C_->skip(bundle);
     }
 
     // Once we're done, clear the bundle.
     bundle.clear();
+    A->dirty_[bundle.dst()/64] &= ~(uint64_t(1) << (bundle.dst()%64));
+}
+
+static void comms_accessor_trace_submit(comms_accessor_t *A,
+                                        comms_bundle_t& bundle,
+                                        size_t first,
+                                        size_t count) {
+    for (size_t index=first; index<first+count; index++) {
+        uint64_t tag = bundle.tag_list_[index];
+        if (A->C_->tracer_.sampled(tag) and bundle.trace(index)) {
+            A->C_->tracer_.stamp(tag, A->lane_, COMMS_TRACE_SUBMIT);
+        }
+    }
 }
 
+// Packets are grouped by destination first, so each bundle takes its
+// packets in as few bulk appends as its capacity allows.
 void comms_accessor_t::submit_n(comms_packet_t packet_list[],
                                 size_t packet_count) {
-    for (size_t index=0; index<packet_count; index++) {
-        uint32_t dst = packet_list[index].submit.dst;
-        comms_bundle_t& bundle = submit_bundles_[dst];
-        bundle.add(packet_list[index]);
+    partition_.run(packet_list, packet_count);
+
+    if (partition_.sparse_) {
+        for (size_t index=0; index<packet_count; index++) {
+            uint32_t dst = partition_.dst_list_[index];
+            comms_bundle_t& bundle = submit_bundle(dst);
+            if (bundle.size() == 0) {
+                comms_accessor_open_bundle(this, bundle);
+            }
+            bundle.add(packet_list[index]);
+
+            if (C_->tracer_.sample_period_) {
+                comms_accessor_trace_submit(this, bundle, bundle.size()-1, 1);
+            }
+
+            if (bundle.size() == buffer_size_) {
+                comms_accessor_submit_bundle(this, *C_->end_points()[dst], bundle);
+            }
+        }
+        return;
+    }
+
+    for (size_t group=0; group<partition_.group_count(); group++) {
+        uint32_t dst = partition_.group_dst(group);
+        const uint32_t *index_list = partition_.group_index_list(group);
+        size_t group_size = partition_.group_size(group);
+        comms_bundle_t& bundle = submit_bundle(dst);
 
-        if (bundle.size() == buffer_size_) {
-            comms_accessor_submit_bundle(this, C_->end_points_[dst], bundle);
+        size_t num_added = 0;
+        while (num_added < group_size) {
+            if (bundle.size() == 0) {
+                comms_accessor_open_bundle(this, bundle);
+            }
+
+            size_t first = bundle.size();
+            size_t count = std::min(group_size-num_added, buffer_size_-first);
+            if (index_list != nullptr) {
+                bundle.add_n(packet_list, index_list+num_added, count);
+            }
+            else {
+                bundle.add_n(packet_list+num_added, count);
+            }
+            num_added += count;
+
+            if (C_->tracer_.sample_period_) {
+                comms_accessor_trace_submit(this, bundle, first, count);
+            }
+
+            if (bundle.size() == buffer_size_) {
+                comms_accessor_submit_bundle(this, *C_->end_points()[dst], bundle);
+            }
         }
     }
 }
 
+// Each chunk of up to COMMS_BUNDLE_SIZE packets is encoded once and fanned
+// out as one bundle per destination, all sharing the encoded message.
+void comms_accessor_t::submit_broadcast_n(comms_packet_t packet_list[],
+                                          size_t packet_count,
+                                          const uint32_t dst_list[],
+                                          size_t dst_count) {
+    comms_bundle_t bundle;
+    for (size_t first=0; first<packet_count; first+=COMMS_BUNDLE_SIZE) {
+        size_t count = std::min(packet_count-first, static_cast<size_t>(COMMS_BUNDLE_SIZE));
+
+        ::google::protobuf::Arena arena;
+        ::comms::PacketBundle *message = ::google::protobuf::Arena::CreateMessage<::comms::PacketBundle>(&arena);
+        message->set_src(C_->local_index_);
+        message->set_lane(lane_);
+        message->mutable_packet()->Reserve(count);
+        for (size_t index=first; index<first+count; index++) {
+            auto *packet = message->add_packet();
+            packet->set_tag(packet_list[index].submit.tag);
+            packet->set_payload(packet_list[index].payload, packet_list[index].submit.size);
+        }
+
+        comms_broadcast_t *broadcast = new comms_broadcast_t(dst_count);
+        bool own_buffer;
+        bool encoded = ::grpc::SerializationTraits<::comms::PacketBundle>::Serialize(*message, &broadcast->message_, &own_buffer).ok();
+
+        bundle.clear();
+        bundle.lane_ = lane_;
+        bundle.opaque_ = (void*)reap_queue_.get();
+        bundle.opened_at_ = comms_now_ns();
+        bundle.broadcast_ = broadcast;
+        bundle.add_n(packet_list+first, count);
+
+        for (size_t index=0; index<dst_count; index++) {
+            EndPoint& end_point = *C_->end_points()[dst_list[index]];
+            bundle.dst_ = dst_list[index];
+            bundle.sequence_ = ordered_ ? end_point.next_sequence(lane_) : 0;
+
+            // A short-circuited local end point would hand the packets to
+            // comms_catch with their reap left to comms_release, so the
+            // broadcast would never complete. Broadcasts go through the
+            // writers to every destination instead.
+            BundleQueue *queue = end_point.deposit_queue(priority_);
+            if (queue == C_->catch_queue_.get()) {
+                queue = priority_ ? C_->priority_queue_.get() : C_->submit_queue_.get();
+            }
+#ifdef COMMS_USE_TOKENS
+            bool ok = encoded and queue->try_enqueue(deposit_token(queue), bundle);
+#else
+            bool ok = encoded and queue->try_enqueue(bundle);
+#endif
+
+            stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_SUBMITTED_PACKETS, count);
+            stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_SUBMITTED_BYTES, bundle.bytes_);
+            if (not ok) {
+                stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_FAILED_PACKETS, count);
+                bundle.reap(COMMS_NOT_SCHEDULED);
+                C_->skip(bundle);
+            }
+        }
+    }
+}
+
+// Only destinations with packets waiting are visited; their bundles go back
+// to the pool afterwards.
 size_t comms_accessor_t::submit_flush() {
     size_t num_flushed = 0;
-    for (size_t index=0; index<end_point_count_; index++) {
-        comms_accessor_submit_bundle(this, C_->end_points_[index], submit_bundles_[index]);
-        num_flushed += submit_bundles_[index].size();
+    for (size_t word=0; word<dirty_.size(); word++) {
+        uint64_t bits = dirty_[word];
+        while (bits != 0) {
+            size_t index = word*64 + __builtin_ctzll(bits);
+            bits &= bits-1;
+
+            comms_bundle_t *bundle = submit_bundles_[index];
+            num_flushed += bundle->size();
+            comms_accessor_submit_bundle(this, *C_->end_points()[index], *bundle);
+            C_->bundle_pool_.release(bundle);
+            submit_bundles_[index] = nullptr;
+        }
     }
     return num_flushed;
 }
 
 size_t comms_accessor_t::reap_n(comms_packet_t packet_list[],
                                 size_t packet_count) {
-    return reap_queue_->try_dequeue_bulk(packet_list, packet_count);
+    size_t num_reaped = 0;
+    if (rings_) {
+        num_reaped = rings_->reap_.pop_n(packet_list, packet_count);
+    }
+
+    if (num_reaped < packet_count) {
+#ifdef COMMS_USE_TOKENS
+        num_reaped += reap_queue_->try_dequeue_bulk(*reap_token_, packet_list+num_reaped, packet_count-num_reaped);
+#else
+        num_reaped += reap_queue_->try_dequeue_bulk(packet_list+num_reaped, packet_count-num_reaped);
+#endif
+    }
+
+    payloads_.recycle(packet_list, num_reaped);
+    return num_reaped;
+}
+
+// Takes the next non-empty bundle off the accessor's catch queue.
+static bool comms_accessor_next_caught(comms_accessor_t *A, comms_bundle_t& bundle) {
+    BundleQueue *queue = A->C_->catch_queue(A->lane_);
+#ifdef COMMS_USE_TOKENS
+    if (not A->catch_token_) {
+        A->catch_token_ = std::unique_ptr<moodycamel::ConsumerToken>(new moodycamel::ConsumerToken(*queue));
+    }
+#endif
+
+    while (true) {
+#ifdef COMMS_USE_TOKENS
+        bool ok = queue->try_dequeue(*A->catch_token_, bundle);
+#else
+        bool ok = queue->try_dequeue(bundle);
+#endif
+        if (not ok) return false;
+        if (bundle.size() > 0) break;
+    }
+
+    if (bundle.trace_count_ > 0) {
+        A->C_->tracer_.stamp(bundle, COMMS_TRACE_CATCH);
+    }
+    A->stats_->add(bundle.src_, bundle.lane(), COMMS_COUNTER_CAUGHT_PACKETS, bundle.size());
+    return true;
 }
 
+// Packets left behind by this accessor come first, then those matching
+// catches set aside, then new bundles.
 size_t comms_accessor_t::catch_n(comms_packet_t packet_list[],
                                  size_t packet_count) {
     size_t num_caught = catch_queue_.try_dequeue_bulk(packet_list, packet_count);
+    num_caught += C_->matcher(lane_).take(0, 0, packet_list+num_caught, packet_count-num_caught);
     if (num_caught == packet_count) {
         return num_caught;
     }
 
     comms_bundle_t bundle;
     while (num_caught < packet_count) {
-        bool ok = C_->catch_queue_->try_dequeue(bundle);
-        if (not ok) return num_caught;
+        if (not comms_accessor_next_caught(this, bundle)) return num_caught;
 
-        size_t count = std::min(packet_count-num_caught, bundle.size());
-        comms_packet_t *packets = bundle.packet_list();
-        memcpy(packet_list+num_caught, packets, sizeof(comms_packet_t)*count);
+        size_t count = bundle.gather_caught(packet_list+num_caught, 0, packet_count-num_caught);
         num_caught += count;
 
         // Extra packets leftover in the bundle.
-        if (count < bundle.size()) {
-            bool ok = catch_queue_.try_enqueue_bulk(packets+count, bundle.size()-count);
+        comms_packet_t packets[COMMS_BUNDLE_GATHER_SIZE];
+        while (count < bundle.size()) {
+            size_t num_gathered = bundle.gather_caught(packets, count, COMMS_BUNDLE_GATHER_SIZE);
+            bool ok = catch_queue_.try_enqueue_bulk(packets, num_gathered);
             if (not ok) { std::cout << "catch: not ok" << std::endl; }
+            count += num_gathered;
         }
     }
     return num_caught;
 }
 
-void comms_accessor_t::release_n(comms_packet_t packet_list[],
-                                 size_t packet_count) {
-    for (size_t index=0; index<packet_count; index++) {
-        while (not static_cast<PacketQueue*>(packet_list[index].opaque)->try_enqueue(packet_list[index])) {
+// Copies the packets matching tag/mask into packet_list while it has room
+// and hands the rest to the matcher.
+static size_t comms_accessor_match(comms_matcher_t& matcher,
+                                   uint64_t tag,
+                                   uint64_t mask,
+                                   const comms_packet_t packets[],
+                                   size_t count,
+                                   comms_packet_t packet_list[],
+                                   size_t packet_count) {
+    comms_packet_t unexpected[COMMS_BUNDLE_GATHER_SIZE];
+    size_t num_matched = 0;
+    size_t num_unexpected = 0;
+    for (size_t index=0; index<count; index++) {
+        if (num_matched < packet_count and (packets[index].caught.opaque & mask) == (tag & mask)) {
+            packet_list[num_matched++] = packets[index];
+        }
+        else {
+            unexpected[num_unexpected++] = packets[index];
+        }
+    }
+    matcher.put(unexpected, num_unexpected);
+    return num_matched;
+}
+
+// Bundles are sorted whole, so packets only ever wait in the matcher and
+// not in this accessor.
+size_t comms_accessor_t::catch_matching_n(uint64_t tag,
+                                          uint64_t mask,
+                                          comms_packet_t packet_list[],
+                                          size_t packet_count) {
+    comms_matcher_t& matcher = C_->matcher(lane_);
+    comms_packet_t packets[COMMS_BUNDLE_GATHER_SIZE];
+    size_t num_caught = 0;
+
+    size_t count;
+    while ((count = catch_queue_.try_dequeue_bulk(packets, COMMS_BUNDLE_GATHER_SIZE)) > 0) {
+        num_caught += comms_accessor_match(matcher, tag, mask, packets, count,
+                                           packet_list+num_caught, packet_count-num_caught);
+    }
+    num_caught += matcher.take(tag, mask, packet_list+num_caught, packet_count-num_caught);
+
+    comms_bundle_t bundle;
+    while (num_caught < packet_count) {
+        if (not comms_accessor_next_caught(this, bundle)) return num_caught;
+
+        for (size_t first=0; first<bundle.size(); first+=count) {
+            count = bundle.gather_caught(packets, first, COMMS_BUNDLE_GATHER_SIZE);
+            num_caught += comms_accessor_match(matcher, tag, mask, packets, count,
+                                               packet_list+num_caught, packet_count-num_caught);
+        }
+    }
+    return num_caught;
+}
+
+// Pushes as much of a run as the queue has room for without allocating, in
+// chunks of at most COMMS_BUNDLE_GATHER_SIZE that halve while they don't fit.
+// Returns the number of packets pushed. A token whose producer could not be
+// allocated is passed over, here and in comms_grow_run.
+static size_t comms_try_enqueue_run(PacketQueue *queue,
+                                    moodycamel::ProducerToken *token,
+                                    comms_packet_t packet_list[],
+                                    size_t packet_count) {
+    size_t num_pushed = 0;
+    size_t count = COMMS_BUNDLE_GATHER_SIZE;
+    while (num_pushed < packet_count and count > 0) {
+        count = std::min(count, packet_count-num_pushed);
+        bool ok = token != nullptr and token->valid() ? queue->try_enqueue_bulk(*token, packet_list+num_pushed, count)
+                                                      : queue->try_enqueue_bulk(packet_list+num_pushed, count);
+        if (ok) {
+            num_pushed += count;
+        }
+        else {
+            count /= 2;
+        }
+    }
+    return num_pushed;
+}
+
+// A consumer that has stalled outright gets the rest with the queue grown;
+// only a failed allocation makes us wait then.
+static void comms_grow_run(PacketQueue *queue,
+                           moodycamel::ProducerToken *token,
+                           comms_packet_t packet_list[],
+                           size_t packet_count) {
+    size_t num_pushed = 0;
+    while (num_pushed < packet_count) {
+        size_t count = std::min(packet_count-num_pushed, size_t(COMMS_BUNDLE_GATHER_SIZE));
+        bool ok = token != nullptr and token->valid() ? queue->enqueue_bulk(*token, packet_list+num_pushed, count)
+                                                      : queue->enqueue_bulk(packet_list+num_pushed, count);
+        if (ok) {
+            num_pushed += count;
+        }
+        else {
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
 }
 
+static void comms_enqueue_run(PacketQueue *queue,
+                              moodycamel::ProducerToken *token,
+                              comms_packet_t packet_list[],
+                              size_t packet_count) {
+    size_t num_pushed = 0;
+    int64_t stalled_at = 0;
+    while (num_pushed < packet_count) {
+        size_t count = comms_try_enqueue_run(queue, token, packet_list+num_pushed, packet_count-num_pushed);
+        num_pushed += count;
+        if (num_pushed == packet_count) return;
+
+        int64_t now = comms_now_ns();
+        if (count > 0 or stalled_at == 0) {
+            stalled_at = now;
+        }
+        else if (now - stalled_at >= int64_t(COMMS_ENQUEUE_STALL_MS)*1000000) {
+            comms_grow_run(queue, token, packet_list+num_pushed, packet_count-num_pushed);
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void comms_enqueue_runs(comms_packet_t packet_list[],
+                        size_t packet_count,
+                        PacketQueue *token_queue,
+                        moodycamel::ProducerToken *token) {
+    size_t index = 0;
+    while (index < packet_count) {
+        PacketQueue *queue = static_cast<PacketQueue*>(packet_list[index].opaque);
+        size_t run = 1;
+        while (index+run < packet_count and packet_list[index+run].opaque == queue) {
+            run++;
+        }
+
+        comms_enqueue_run(queue, queue == token_queue ? token : nullptr, packet_list+index, run);
+        index += run;
+    }
+}
+
+void comms_accessor_t::release_n(comms_packet_t packet_list[],
+                                 size_t packet_count) {
+#ifdef COMMS_USE_TOKENS
+    if (not release_token_) {
+        release_token_ = std::unique_ptr<moodycamel::ProducerToken>(new moodycamel::ProducerToken(*C_->release_queue_));
+    }
+    comms_enqueue_runs(packet_list, packet_count, C_->release_queue_.get(), release_token_.get());
+#else
+    comms_enqueue_runs(packet_list, packet_count);
+#endif
+}
+
 int comms_accessor_create(comms_accessor_t **A,
                           comms_t *C,
                           int lane,
@@ -119,6 +532,7 @@ int comms_accessor_create(comms_accessor_t **A,
 
     try {
         A[0] = new comms_accessor_t(C, lane);
+        C->attach(A[0]);
         return 0;
     }
     catch (std::bad_alloc& e) {
@@ -131,6 +545,9 @@ int comms_accessor_create(comms_accessor_t **A,
 
 int comms_accessor_destroy(comms_accessor_t *A,
                            char **error) {
+    if (A->C_ != NULL) {
+        A->C_->detach(A);
+    }
     A->C_ = NULL;
     delete A;
     return 0;
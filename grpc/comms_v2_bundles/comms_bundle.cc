@@ -1,30 +1,202 @@
+#include <algorithm>
+
 extern "C" {
 #include "comms.h"
 }
 #include "comms_impl.h"
 
 comms_bundle_t::comms_bundle_t()
-        : size_(0) {
+        : size_(0)
+        , dst_(0)
+        , src_(0)
+        , lane_(0)
+        , rc_(COMMS_SUCCESS)
+        , charged_(false)
+        , bytes_(0)
+        , opened_at_(0)
+        , opaque_(nullptr)
+        , broadcast_(nullptr)
+        , sequence_(0)
+        , id_(0)
+        , trace_count_(0) {
 }
 
 void comms_bundle_t::add(const comms_packet_t& packet) {
-    packet_list_[size_++] = packet;
+    add(packet.submit.size, packet.submit.tag, packet.payload);
+}
+
+void comms_bundle_t::add(uint32_t size,
+                         uint64_t tag,
+                         uint8_t *payload) {
+    bytes_ += size;
+    size_list_[size_] = size;
+    tag_list_[size_] = tag;
+    payload_list_[size_] = payload;
+    size_++;
+}
+
+void comms_bundle_t::add_n(const comms_packet_t packet_list[],
+                           size_t packet_count) {
+    for (size_t index=0; index<packet_count; index++) {
+        size_list_[size_+index] = packet_list[index].submit.size;
+        bytes_ += packet_list[index].submit.size;
+    }
+    for (size_t index=0; index<packet_count; index++) {
+        tag_list_[size_+index] = packet_list[index].submit.tag;
+    }
+    for (size_t index=0; index<packet_count; index++) {
+        payload_list_[size_+index] = packet_list[index].payload;
+    }
+    size_ += packet_count;
+}
+
+void comms_bundle_t::add_n(const comms_packet_t packet_list[],
+                           const uint32_t index_list[],
+                           size_t packet_count) {
+    for (size_t index=0; index<packet_count; index++) {
+        const comms_packet_t& packet = packet_list[index_list[index]];
+        size_list_[size_+index] = packet.submit.size;
+        tag_list_[size_+index] = packet.submit.tag;
+        payload_list_[size_+index] = packet.payload;
+        bytes_ += packet.submit.size;
+    }
+    size_ += packet_count;
 }
 
 size_t comms_bundle_t::size() const {
     return size_;
 }
 
+uint32_t comms_bundle_t::dst() const {
+    return dst_;
+}
+
+uint32_t comms_bundle_t::lane() const {
+    return lane_;
+}
+
 void comms_bundle_t::clear() {
     size_ = 0;
+    rc_ = COMMS_SUCCESS;
+    charged_ = false;
+    bytes_ = 0;
+    opaque_ = nullptr;
+    broadcast_ = nullptr;
+    sequence_ = 0;
+    id_ = 0;
+    trace_count_ = 0;
+}
+
+void comms_bundle_t::set_reap_rc(int rc) {
+    rc_ = rc;
 }
 
-comms_packet_t *comms_bundle_t::packet_list() {
-    return packet_list_;
+size_t comms_bundle_t::gather_reaped(comms_packet_t packet_list[],
+                                     size_t first,
+                                     size_t count) const {
+    count = std::min(count, size_-first);
+    for (size_t index=0; index<count; index++) {
+        comms_packet_t& packet = packet_list[index];
+        packet.reap.size = size_list_[first+index];
+        packet.reap.rc = rc_;
+        packet.reap.tag = tag_list_[first+index];
+        packet.payload = payload_list_[first+index];
+        packet.opaque = opaque_;
+    }
+    return count;
 }
 
-void comms_bundle_t::set_reap_rc(int rc) {
-    for (size_t index=0; index<size_; index++) {
-        packet_list_[index].reap.rc = rc;
+size_t comms_bundle_t::gather_caught(comms_packet_t packet_list[],
+                                     size_t first,
+                                     size_t count) const {
+    count = std::min(count, size_-first);
+    for (size_t index=0; index<count; index++) {
+        comms_packet_t& packet = packet_list[index];
+        packet.caught.size = size_list_[first+index];
+        packet.caught.src = src_;
+        packet.caught.opaque = tag_list_[first+index];
+        packet.payload = payload_list_[first+index];
+        packet.opaque = opaque_;
+    }
+    return count;
+}
+
+// Hands the packets back to their owner, through the reap ring if given while
+// it has room and the owner's reap queue otherwise. The caller keeps the ring
+// alive.
+void comms_bundle_t::reap(int rc,
+                          comms_ring_t<comms_packet_t> *reap_ring) {
+    // A broadcast is reaped once, by the last of its destinations.
+    if (broadcast_ != nullptr) {
+        if (not broadcast_->complete(rc)) return;
+        rc = broadcast_->rc_;
+        delete broadcast_;
+        broadcast_ = nullptr;
+    }
+    set_reap_rc(rc);
+
+    comms_packet_t packet_list[COMMS_BUNDLE_GATHER_SIZE];
+    size_t first = 0;
+    while (first < size_) {
+        size_t count = gather_reaped(packet_list, first, COMMS_BUNDLE_GATHER_SIZE);
+        size_t num_pushed = 0;
+        if (reap_ring != nullptr) {
+            num_pushed = reap_ring->push_n(packet_list, count);
+            if (num_pushed < count) reap_ring = nullptr;
+        }
+        comms_enqueue_runs(packet_list+num_pushed, count-num_pushed);
+        first += count;
+    }
+}
+
+bool comms_bundle_t::trace(size_t index) {
+    if (trace_count_ == COMMS_TRACE_BUNDLE_SLOTS) return false;
+    trace_index_[trace_count_++] = static_cast<uint16_t>(index);
+    return true;
+}
+
+comms_broadcast_t::comms_broadcast_t(size_t dst_count)
+        : remaining_(dst_count)
+        , rc_(COMMS_SUCCESS)
+        , undrained_(false) {
+}
+
+// Keeps the first failure; returns true for the last destination.
+// A duplicate was delivered by an earlier attempt and counts as a success.
+bool comms_broadcast_t::complete(int rc) {
+    if (rc != COMMS_SUCCESS and rc != COMMS_DUPLICATE) {
+        int expected = COMMS_SUCCESS;
+        rc_.compare_exchange_strong(expected, rc);
+    }
+    return remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+comms_bundle_pool_t::~comms_bundle_pool_t() {
+    for (comms_bundle_t *bundle : bundles_) {
+        delete bundle;
+    }
+}
+
+comms_bundle_t *comms_bundle_pool_t::acquire() {
+    {
+        std::unique_lock<std::mutex> lck(mtx_);
+        if (not bundles_.empty()) {
+            comms_bundle_t *bundle = bundles_.back();
+            bundles_.pop_back();
+            return bundle;
+        }
+    }
+    return new comms_bundle_t();
+}
+
+void comms_bundle_pool_t::release(comms_bundle_t *bundle) {
+    bundle->clear();
+    {
+        std::unique_lock<std::mutex> lck(mtx_);
+        if (bundles_.size() < COMMS_BUNDLE_POOL_SIZE) {
+            bundles_.push_back(bundle);
+            return;
+        }
     }
+    delete bundle;
 }
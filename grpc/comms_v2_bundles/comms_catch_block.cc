@@ -0,0 +1,75 @@
+#include <cstring>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+// Each payload slot holds the back pointer followed by the payload, padded so
+// that the next back pointer stays aligned.
+static size_t comms_catch_slot_size(size_t payload_size) {
+    const size_t align = alignof(comms_catch_block_t*);
+    return sizeof(comms_catch_block_t*) + ((payload_size + align - 1) & ~(align - 1));
+}
+
+// Payloads come from the packets themselves or, for a compressed bundle, from
+// the decompressed block in packet order.
+comms_catch_block_t *comms_catch_block_t::create(const ::comms::PacketBundle& request,
+                                                 const uint8_t *payloads,
+                                                 comms_bundle_t& bundle,
+                                                 PacketQueue *release_queue) {
+    const int packet_count = request.packet_size();
+
+    size_t total_size = sizeof(comms_catch_block_t);
+    for (int index=0; index<packet_count; index++) {
+        const ::comms::Packet& packet = request.packet(index);
+        total_size += comms_catch_slot_size(payloads ? packet.size() : packet.payload().size());
+    }
+
+    void *memory = malloc(total_size);
+    if (memory == nullptr) return nullptr;
+
+    comms_catch_block_t *block = new (memory) comms_catch_block_t();
+    block->refs_ = packet_count;
+    block->src_ = static_cast<uint32_t>(request.src());
+    block->lane_ = static_cast<uint32_t>(request.lane());
+    block->traced_ = false;
+
+    bundle.clear();
+    bundle.src_ = block->src_;
+    bundle.lane_ = block->lane_;
+    bundle.opaque_ = (void*)release_queue;
+
+    uint8_t *slot = static_cast<uint8_t*>(memory) + sizeof(comms_catch_block_t);
+    for (int index=0; index<packet_count; index++) {
+        const ::comms::Packet& packet = request.packet(index);
+        const uint8_t *payload = payloads ? payloads : reinterpret_cast<const uint8_t*>(packet.payload().data());
+        size_t payload_size = payloads ? packet.size() : packet.payload().size();
+
+        memcpy(slot, &block, sizeof(comms_catch_block_t*));
+        uint8_t *data = slot + sizeof(comms_catch_block_t*);
+        memcpy(data, payload, payload_size);
+        if (payloads) payloads += payload_size;
+
+        bundle.add(static_cast<uint32_t>(payload_size), packet.tag(), data);
+
+        slot += comms_catch_slot_size(payload_size);
+    }
+
+    return block;
+}
+
+comms_catch_block_t *comms_catch_block_t::from_payload(uint8_t *payload) {
+    comms_catch_block_t *block;
+    memcpy(&block, payload - sizeof(comms_catch_block_t*), sizeof(comms_catch_block_t*));
+    return block;
+}
+
+bool comms_catch_block_t::unref(size_t count) {
+    return refs_.fetch_sub(count, std::memory_order_acq_rel) == count;
+}
+
+void comms_catch_block_t::destroy() {
+    this->~comms_catch_block_t();
+    free(this);
+}
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <memory>
+
+#ifdef COMMS_USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef COMMS_USE_ZSTD
+#include <zstd.h>
+#endif
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+bool comms_codec_available(int codec) {
+    switch (codec) {
+    case COMMS_CODEC_NONE:
+        return true;
+#ifdef COMMS_USE_LZ4
+    case COMMS_CODEC_LZ4:
+        return true;
+#endif
+#ifdef COMMS_USE_ZSTD
+    case COMMS_CODEC_ZSTD:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+size_t comms_codec_bound(int codec, size_t size) {
+    switch (codec) {
+#ifdef COMMS_USE_LZ4
+    case COMMS_CODEC_LZ4:
+        return static_cast<size_t>(LZ4_compressBound(static_cast<int>(size)));
+#endif
+#ifdef COMMS_USE_ZSTD
+    case COMMS_CODEC_ZSTD:
+        return ZSTD_compressBound(size);
+#endif
+    default:
+        return 0;
+    }
+}
+
+#ifdef COMMS_USE_ZSTD
+// Compression contexts are reused per thread; creating one is far more
+// expensive than compressing a bundle.
+struct comms_zstd_cctx_deleter_t {
+    void operator()(ZSTD_CCtx *ctx) const { ZSTD_freeCCtx(ctx); }
+};
+struct comms_zstd_dctx_deleter_t {
+    void operator()(ZSTD_DCtx *ctx) const { ZSTD_freeDCtx(ctx); }
+};
+static thread_local std::unique_ptr<ZSTD_CCtx, comms_zstd_cctx_deleter_t> comms_zstd_cctx;
+static thread_local std::unique_ptr<ZSTD_DCtx, comms_zstd_dctx_deleter_t> comms_zstd_dctx;
+#endif
+
+// Returns the compressed size, or 0 if the codec is unavailable or the
+// output does not fit.
+size_t comms_codec_compress(int codec,
+                            int level,
+                            const uint8_t *src,
+                            size_t size,
+                            uint8_t *dst,
+                            size_t capacity) {
+    switch (codec) {
+#ifdef COMMS_USE_LZ4
+    case COMMS_CODEC_LZ4: {
+        int rc = LZ4_compress_default(reinterpret_cast<const char*>(src), reinterpret_cast<char*>(dst),
+                                      static_cast<int>(size), static_cast<int>(capacity));
+        return rc > 0 ? static_cast<size_t>(rc) : 0;
+    }
+#endif
+#ifdef COMMS_USE_ZSTD
+    case COMMS_CODEC_ZSTD: {
+        if (not comms_zstd_cctx) {
+            comms_zstd_cctx.reset(ZSTD_createCCtx());
+            if (not comms_zstd_cctx) return 0;
+        }
+        size_t rc = ZSTD_compressCCtx(comms_zstd_cctx.get(), dst, capacity, src, size, level);
+        return ZSTD_isError(rc) ? 0 : rc;
+    }
+#endif
+    default:
+        return 0;
+    }
+}
+
+// Succeeds only if the block decompresses to exactly capacity bytes.
+bool comms_codec_decompress(int codec,
+                            const uint8_t *src,
+                            size_t size,
+                            uint8_t *dst,
+                            size_t capacity) {
+    switch (codec) {
+#ifdef COMMS_USE_LZ4
+    case COMMS_CODEC_LZ4: {
+        int rc = LZ4_decompress_safe(reinterpret_cast<const char*>(src), reinterpret_cast<char*>(dst),
+                                     static_cast<int>(size), static_cast<int>(capacity));
+        return rc >= 0 and static_cast<size_t>(rc) == capacity;
+    }
+#endif
+#ifdef COMMS_USE_ZSTD
+    case COMMS_CODEC_ZSTD: {
+        if (not comms_zstd_dctx) {
+            comms_zstd_dctx.reset(ZSTD_createDCtx());
+            if (not comms_zstd_dctx) return false;
+        }
+        size_t rc = ZSTD_decompressDCtx(comms_zstd_dctx.get(), dst, capacity, src, size);
+        return not ZSTD_isError(rc) and rc == capacity;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+comms_codec_policy_t::comms_codec_policy_t()
+        : ratio_(1.0)
+        , compress_ns_per_byte_(0.0)
+        , wire_ns_per_byte_(0.0)
+        , bundles_(0) {
+}
+
+static void comms_codec_smooth(std::atomic<double>& estimate,
+                               double sample,
+                               bool first) {
+    double previous = estimate.load(std::memory_order_relaxed);
+    estimate.store(first ? sample : previous + (sample - previous) / 8, std::memory_order_relaxed);
+}
+
+// Compresses every bundle while warming up and one in
+// COMMS_CODEC_PROBE_INTERVAL afterwards so the estimates keep up with the
+// payloads; otherwise only when the bytes saved are worth more wire time
+// than the compression costs.
+bool comms_codec_policy_t::compress() {
+    uint64_t bundle = bundles_.fetch_add(1, std::memory_order_relaxed);
+    if (bundle < COMMS_CODEC_WARMUP or bundle % COMMS_CODEC_PROBE_INTERVAL == 0) {
+        return true;
+    }
+
+    double saved_ns = (1.0 - ratio_.load(std::memory_order_relaxed)) * wire_ns_per_byte_.load(std::memory_order_relaxed);
+    return saved_ns > compress_ns_per_byte_.load(std::memory_order_relaxed);
+}
+
+void comms_codec_policy_t::record_compression(size_t size,
+                                              size_t compressed_size,
+                                              int64_t elapsed_ns) {
+    if (size == 0) return;
+    bool first = compress_ns_per_byte_.load(std::memory_order_relaxed) == 0.0;
+    comms_codec_smooth(ratio_, std::min(1.0, static_cast<double>(compressed_size) / size), first);
+    comms_codec_smooth(compress_ns_per_byte_, static_cast<double>(elapsed_ns) / size, first);
+}
+
+void comms_codec_policy_t::record_transmit(size_t wire_size,
+                                           int64_t elapsed_ns) {
+    if (wire_size == 0) return;
+    bool first = wire_ns_per_byte_.load(std::memory_order_relaxed) == 0.0;
+    comms_codec_smooth(wire_ns_per_byte_, static_cast<double>(elapsed_ns) / wire_size, first);
+}
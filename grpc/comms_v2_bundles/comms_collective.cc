@@ -0,0 +1,594 @@
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+// Reduction kernels. The loops are written for the auto-vectorizer and
+// compiled twice, for the baseline ISA and for AVX2, with the variant picked
+// once per process as in comms_partition.cc. Min and max are spelled as
+// compares so they map onto the packed min/max instructions.
+template <typename T>
+struct comms_reduce_sum_t {
+    static inline T apply(T a, T b) { return a + b; }
+};
+
+template <typename T>
+struct comms_reduce_min_t {
+    static inline T apply(T a, T b) { return b < a ? b : a; }
+};
+
+template <typename T>
+struct comms_reduce_max_t {
+    static inline T apply(T a, T b) { return a < b ? b : a; }
+};
+
+template <typename T, typename Op>
+static inline __attribute__((always_inline)) void comms_reduce_loop(void *dst,
+                                                                    const void *src,
+                                                                    size_t count) {
+    T *__restrict__ d = static_cast<T*>(dst);
+    const T *__restrict__ s = static_cast<const T*>(src);
+    for (size_t index=0; index<count; index++) {
+        d[index] = Op::apply(d[index], s[index]);
+    }
+}
+
+template <typename T, typename Op>
+static void comms_reduce_generic(void *dst, const void *src, size_t count) {
+    comms_reduce_loop<T, Op>(dst, src, count);
+}
+
+template <typename T, typename Op>
+__attribute__((target("avx2")))
+static void comms_reduce_avx2(void *dst, const void *src, size_t count) {
+    comms_reduce_loop<T, Op>(dst, src, count);
+}
+
+// Rows follow COMMS_DTYPE_*, columns COMMS_OP_*.
+#define COMMS_REDUCE_ROW(kernel, T) \
+    { kernel<T, comms_reduce_sum_t<T>>, kernel<T, comms_reduce_min_t<T>>, kernel<T, comms_reduce_max_t<T>> }
+
+static const comms_reduce_fn_t comms_reduce_generic_table[4][3] = {
+    COMMS_REDUCE_ROW(comms_reduce_generic, int32_t),
+    COMMS_REDUCE_ROW(comms_reduce_generic, int64_t),
+    COMMS_REDUCE_ROW(comms_reduce_generic, float),
+    COMMS_REDUCE_ROW(comms_reduce_generic, double),
+};
+
+static const comms_reduce_fn_t comms_reduce_avx2_table[4][3] = {
+    COMMS_REDUCE_ROW(comms_reduce_avx2, int32_t),
+    COMMS_REDUCE_ROW(comms_reduce_avx2, int64_t),
+    COMMS_REDUCE_ROW(comms_reduce_avx2, float),
+    COMMS_REDUCE_ROW(comms_reduce_avx2, double),
+};
+
+static bool comms_reduce_has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+// Null for an unknown type or operator.
+comms_reduce_fn_t comms_reduce_kernel(int dtype, int op) {
+    static const bool avx2 = comms_reduce_has_avx2();
+    if (dtype < COMMS_DTYPE_INT32 or dtype > COMMS_DTYPE_FLOAT64 or op < COMMS_OP_SUM or op > COMMS_OP_MAX) {
+        return nullptr;
+    }
+    return avx2 ? comms_reduce_avx2_table[dtype][op] : comms_reduce_generic_table[dtype][op];
+}
+
+size_t comms_dtype_size(int dtype) {
+    switch (dtype) {
+    case COMMS_DTYPE_INT32:   return sizeof(int32_t);
+    case COMMS_DTYPE_INT64:   return sizeof(int64_t);
+    case COMMS_DTYPE_FLOAT32: return sizeof(float);
+    case COMMS_DTYPE_FLOAT64: return sizeof(double);
+    default:                  return 0;
+    }
+}
+
+static size_t comms_collective_chunk_count(size_t size) {
+    return std::max<size_t>(1, (size + COMMS_COLLECTIVE_CHUNK_SIZE - 1) / COMMS_COLLECTIVE_CHUNK_SIZE);
+}
+
+comms_collective_t::comms_collective_t(comms_t *C, comms_accessor_t *A)
+        : C_(C)
+        , A_(A)
+        , rank_(static_cast<uint32_t>(C->local_index_))
+        , size_(static_cast<uint32_t>(C->end_points().size()))
+        , membership_version_(C->membership_version_)
+        , sequence_(0)
+        , outstanding_(0)
+        , deadline_ns_(0) {
+}
+
+comms_collective_t::~comms_collective_t() {
+    for (auto& entry : unexpected_) {
+        A_->release_n(&entry.second, 1);
+    }
+}
+
+uint64_t comms_collective_t::tag(uint32_t step, uint32_t chunk) const {
+    return (uint64_t(sequence_) << 32) | (uint64_t(step) << 16) | chunk;
+}
+
+// Starts the next operation. Chunks left over from an operation that failed
+// are dropped; those of later operations, from peers that are ahead of us,
+// are kept.
+void comms_collective_t::begin() {
+    sequence_++;
+    deadline_ns_ = comms_now_ns() + static_cast<int64_t>(C_->conf_.collective_timeout)*1000000;
+    error_.clear();
+
+    for (auto it=unexpected_.begin(); it!=unexpected_.end(); ) {
+        if ((it->first.second >> 32) < sequence_) {
+            A_->release_n(&it->second, 1);
+            it = unexpected_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+// Every operation waits for its sends, failed or not, since the packets
+// point into the caller's buffers.
+bool comms_collective_t::end(bool ok) {
+    bool sent = wait_sent();
+    return ok and sent;
+}
+
+static size_t comms_collective_reap(comms_collective_t *G) {
+    comms_packet_t packet_list[COMMS_BUNDLE_GATHER_SIZE];
+    size_t num_reaped = G->A_->reap_n(packet_list, COMMS_BUNDLE_GATHER_SIZE);
+    G->outstanding_ -= std::min(G->outstanding_, num_reaped);
+    for (size_t index=0; index<num_reaped; index++) {
+        if (packet_list[index].reap.rc != COMMS_SUCCESS and packet_list[index].reap.rc != COMMS_DUPLICATE
+                and G->error_.empty()) {
+            std::stringstream ss;
+            ss << "Collective chunk with tag " << packet_list[index].reap.tag
+               << " was not delivered; Reap code: " << packet_list[index].reap.rc;
+            G->error_ = ss.str();
+        }
+    }
+    return num_reaped;
+}
+
+// Reaps finished sends and moves caught chunks into unexpected_. Returns
+// false once a send has failed, comms is shutting down or the operation ran
+// past its deadline.
+bool comms_collective_t::progress() {
+    size_t num_reaped = comms_collective_reap(this);
+
+    comms_packet_t packet_list[COMMS_BUNDLE_GATHER_SIZE];
+    size_t num_caught = A_->catch_n(packet_list, COMMS_BUNDLE_GATHER_SIZE);
+    // A chunk arriving twice (a retry that got through both times) is
+    // released; the first copy is kept.
+    for (size_t index=0; index<num_caught; index++) {
+        comms_packet_t& packet = packet_list[index];
+        if (not unexpected_.emplace(std::make_pair(packet.caught.src, packet.caught.opaque), packet).second) {
+            A_->release_n(&packet, 1);
+        }
+    }
+
+    if (not error_.empty()) return false;
+    if (num_reaped > 0 or num_caught > 0) return true;
+
+    if (C_->shutting_down_) {
+        error_ = "Collective interrupted, comms layer is shutting down.";
+        return false;
+    }
+    if (comms_now_ns() > deadline_ns_) {
+        std::stringstream ss;
+        ss << "Collective did not complete within " << C_->conf_.collective_timeout << " ms.";
+        error_ = ss.str();
+        return false;
+    }
+    std::this_thread::yield();
+    return true;
+}
+
+void comms_collective_t::send(uint32_t dst,
+                              uint32_t step,
+                              const uint8_t *data,
+                              size_t size) {
+    size_t chunk_count = comms_collective_chunk_count(size);
+    send_list_.clear();
+    for (size_t chunk=0; chunk<chunk_count; chunk++) {
+        size_t offset = chunk*COMMS_COLLECTIVE_CHUNK_SIZE;
+        comms_packet_t packet;
+        packet.submit.size = static_cast<uint32_t>(std::min<size_t>(COMMS_COLLECTIVE_CHUNK_SIZE, size-offset));
+        packet.submit.dst = dst;
+        packet.submit.tag = tag(step, static_cast<uint32_t>(chunk));
+        packet.payload = const_cast<uint8_t*>(data) + offset;
+        packet.opaque = nullptr;
+        send_list_.push_back(packet);
+
+        if (send_list_.size() == COMMS_COLLECTIVE_BUNDLE_CHUNKS or chunk+1 == chunk_count) {
+            comms_submit_scope_t scope(A_);
+            if (not scope.open()) {
+                if (error_.empty()) error_ = "Collective interrupted, comms layer is draining or shutting down.";
+                return;
+            }
+            A_->submit_n(send_list_.data(), send_list_.size());
+            A_->submit_flush();
+            outstanding_ += send_list_.size();
+            send_list_.clear();
+        }
+    }
+}
+
+// Hands each chunk of the message from src to consume in order, as it
+// arrives.
+bool comms_collective_t::receive(uint32_t src,
+                                 uint32_t step,
+                                 size_t size,
+                                 const consumer_t& consume) {
+    size_t chunk_count = comms_collective_chunk_count(size);
+    for (size_t chunk=0; chunk<chunk_count; chunk++) {
+        auto key = std::make_pair(src, tag(step, static_cast<uint32_t>(chunk)));
+        auto it = unexpected_.find(key);
+        while (it == unexpected_.end()) {
+            if (not progress()) return false;
+            it = unexpected_.find(key);
+        }
+        comms_packet_t packet = it->second;
+        unexpected_.erase(it);
+
+        size_t offset = chunk*COMMS_COLLECTIVE_CHUNK_SIZE;
+        size_t expected = std::min<size_t>(COMMS_COLLECTIVE_CHUNK_SIZE, size-offset);
+        bool ok = packet.caught.size == expected;
+        if (ok) {
+            consume(offset, packet.payload, expected);
+        }
+        A_->release_n(&packet, 1);
+
+        if (not ok) {
+            std::stringstream ss;
+            ss << "Collective chunk from end point " << src << " has " << packet.caught.size
+               << " bytes, expected " << expected << "; End points disagree on the message size.";
+            error_ = ss.str();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool comms_collective_t::receive_into(uint32_t src,
+                                      uint32_t step,
+                                      uint8_t *data,
+                                      size_t size) {
+    return receive(src, step, size, [data](size_t offset, const uint8_t *payload, size_t count) {
+        memcpy(data+offset, payload, count);
+    });
+}
+
+bool comms_collective_t::wait_sent() {
+    while (outstanding_ > 0) {
+        if (comms_collective_reap(this) > 0) continue;
+        if (C_->shutdown_) {
+            if (error_.empty()) error_ = "Collective interrupted, comms layer is shut down.";
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return error_.empty();
+}
+
+// Binomial tree over ranks relative to the root: a rank receives from the
+// rank that differs in its lowest set bit and forwards to the ranks below
+// that bit, so the message reaches everyone in ceil(log2(size)) rounds.
+bool comms_collective_t::broadcast(uint8_t *data,
+                                   size_t size,
+                                   uint32_t root,
+                                   uint32_t step) {
+    uint32_t relative = (rank_ + size_ - root) % size_;
+    uint32_t mask = 1;
+    uint32_t bit = 0;
+    while (mask < size_) {
+        if (relative & mask) {
+            if (not receive_into((rank_ + size_ - mask) % size_, step + bit, data, size)) return false;
+            break;
+        }
+        mask <<= 1;
+        bit++;
+    }
+
+    while (mask > 1) {
+        mask >>= 1;
+        bit--;
+        if (relative + mask < size_) {
+            send((rank_ + mask) % size_, step + bit, data, size);
+        }
+    }
+    return true;
+}
+
+bool comms_collective_t::gather(const uint8_t *send_data,
+                                size_t size,
+                                uint8_t *recv,
+                                uint32_t root) {
+    if (rank_ != root) {
+        send(root, 0, send_data, size);
+        return true;
+    }
+
+    memmove(recv + size_t(rank_)*size, send_data, size);
+    for (uint32_t src=0; src<size_; src++) {
+        if (src == rank_) continue;
+        if (not receive_into(src, 0, recv + size_t(src)*size, size)) return false;
+    }
+    return true;
+}
+
+bool comms_collective_t::scatter(const uint8_t *send_data,
+                                 size_t size,
+                                 uint8_t *recv,
+                                 uint32_t root) {
+    if (rank_ != root) {
+        return receive_into(root, 0, recv, size);
+    }
+
+    for (uint32_t dst=0; dst<size_; dst++) {
+        if (dst == rank_) continue;
+        send(dst, 0, send_data + size_t(dst)*size, size);
+    }
+    memmove(recv, send_data + size_t(rank_)*size, size);
+    return true;
+}
+
+// Binomial reduce onto rank 0 (steps 0-31), then broadcast from there
+// (steps 32 and up). 2*ceil(log2(size)) rounds of the full vector.
+bool comms_collective_t::allreduce_tree(uint8_t *data,
+                                        size_t count,
+                                        size_t element_size,
+                                        comms_reduce_fn_t reduce) {
+    size_t size = count*element_size;
+    auto consume = [data, element_size, reduce](size_t offset, const uint8_t *payload, size_t chunk_size) {
+        reduce(data+offset, payload, chunk_size/element_size);
+    };
+
+    uint32_t bit = 0;
+    for (uint32_t mask=1; mask<size_; mask<<=1, bit++) {
+        if (rank_ & mask) {
+            send(rank_ - mask, bit, data, size);
+            break;
+        }
+        if (rank_ + mask < size_ and not receive(rank_ + mask, bit, size, consume)) return false;
+    }
+
+    // The partial result must be on its way before the broadcast
+    // overwrites it.
+    if (not wait_sent()) return false;
+    return broadcast(data, size, 0, 32);
+}
+
+// Reduce-scatter then all-gather around the ring, one segment per rank:
+// 2*(size-1) rounds, each moving 1/size of the vector, so every rank sends
+// and receives about twice the vector whatever the number of ranks.
+bool comms_collective_t::allreduce_ring(uint8_t *data,
+                                        size_t count,
+                                        size_t element_size,
+                                        comms_reduce_fn_t reduce) {
+    const uint32_t n = size_;
+    const uint32_t right = (rank_ + 1) % n;
+    const uint32_t left = (rank_ + n - 1) % n;
+    auto segment_offset = [count, n, element_size](uint32_t segment) {
+        return (count*segment/n)*element_size;
+    };
+    auto segment_size = [&](uint32_t segment) {
+        return segment_offset(segment+1) - segment_offset(segment);
+    };
+
+    // After step k a rank holds segment rank-k-1 reduced over k+2 ranks.
+    for (uint32_t step=0; step<n-1; step++) {
+        uint32_t send_segment = (rank_ + n - step) % n;
+        uint32_t recv_segment = (rank_ + 2*n - step - 1) % n;
+        send(right, step, data + segment_offset(send_segment), segment_size(send_segment));
+
+        uint8_t *recv_data = data + segment_offset(recv_segment);
+        bool ok = receive(left, step, segment_size(recv_segment),
+                          [recv_data, element_size, reduce](size_t offset, const uint8_t *payload, size_t chunk_size) {
+            reduce(recv_data+offset, payload, chunk_size/element_size);
+        });
+        if (not ok) return false;
+    }
+
+    // The all-gather overwrites exactly the segments sent above.
+    if (not wait_sent()) return false;
+
+    for (uint32_t step=0; step<n-1; step++) {
+        uint32_t send_segment = (rank_ + 1 + n - step) % n;
+        uint32_t recv_segment = (rank_ + n - step) % n;
+        send(right, n-1+step, data + segment_offset(send_segment), segment_size(send_segment));
+        if (not receive_into(left, n-1+step, data + segment_offset(recv_segment), segment_size(recv_segment))) return false;
+    }
+    return true;
+}
+
+int comms_collective_create(comms_collective_t **G,
+                            comms_t *C,
+                            int lane,
+                            char **error) {
+    if (lane < 0 or lane >= C->lane_count_) {
+        std::stringstream ss;
+        ss << "Invalid lane number. Valid range: [0, " << C->lane_count_
+           << "); Lane provided: " << lane;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    if (not C->exclusive_lane(lane)) {
+        std::stringstream ss;
+        ss << "Collectives need an exclusive lane (see exclusive-lanes); Lane provided: " << lane;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    // Ring steps and chunk indices share 32 bits of the tag.
+    if (C->end_points().size() > (1<<15)) {
+        std::stringstream ss;
+        ss << "Collectives support at most " << (1<<15) << " end points; End points: " << C->end_points().size();
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    for (size_t index=0; index<C->end_points().size(); index++) {
+        if (C->end_points()[index]->removed()) {
+            std::stringstream ss;
+            ss << "Collectives need every end point in the membership; End point removed: " << index;
+            comms_set_error(error, ss.str().c_str());
+            return 1;
+        }
+    }
+
+    if (not C->started_) {
+        std::stringstream ss;
+        ss << "Cannot create a collective before the comms layer has started.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    try {
+        comms_accessor_t *A = new comms_accessor_t(C, lane);
+        C->attach(A);
+        G[0] = new comms_collective_t(C, A);
+        return 0;
+    }
+    catch (std::bad_alloc& e) {
+        std::stringstream ss;
+        ss << "Unable to allocate memory for collective.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+}
+
+int comms_collective_destroy(comms_collective_t *G,
+                             char **error) {
+    comms_accessor_t *A = G->A_;
+    delete G;
+    return comms_accessor_destroy(A, error);
+}
+
+static int comms_collective_check(comms_collective_t *G,
+                                  size_t size,
+                                  uint32_t root,
+                                  char **error) {
+    if (G->A_->C_ == NULL) {
+        std::stringstream ss;
+        ss << "Cannot run collective, accessor is not bound to a comms object.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    // Ranks are fixed when the collective is created.
+    if (G->membership_version_ != G->C_->membership_version_) {
+        std::stringstream ss;
+        ss << "Membership changed since the collective was created; create a new one.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    if (root >= G->size_) {
+        std::stringstream ss;
+        ss << "Invalid root. Valid range: [0, " << G->size_ << "); Root provided: " << root;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    if (size > size_t(COMMS_COLLECTIVE_CHUNK_SIZE)*COMMS_COLLECTIVE_MAX_CHUNKS) {
+        std::stringstream ss;
+        ss << "Collective message too large. Maximum size: "
+           << size_t(COMMS_COLLECTIVE_CHUNK_SIZE)*COMMS_COLLECTIVE_MAX_CHUNKS << "; Size provided: " << size;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int comms_collective_finish(comms_collective_t *G,
+                                   bool ok,
+                                   char **error) {
+    ok = G->end(ok);
+    if (not ok) {
+        comms_set_error(error, G->error_.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int comms_collective_broadcast(comms_collective_t *G,
+                               void *buffer,
+                               size_t size,
+                               uint32_t root,
+                               char **error) {
+    if (comms_collective_check(G, size, root, error)) return 1;
+    G->begin();
+    bool ok = G->broadcast(static_cast<uint8_t*>(buffer), size, root, 0);
+    return comms_collective_finish(G, ok, error);
+}
+
+int comms_collective_gather(comms_collective_t *G,
+                            const void *send,
+                            size_t size,
+                            void *recv,
+                            uint32_t root,
+                            char **error) {
+    if (comms_collective_check(G, size, root, error)) return 1;
+    G->begin();
+    bool ok = G->gather(static_cast<const uint8_t*>(send), size, static_cast<uint8_t*>(recv), root);
+    return comms_collective_finish(G, ok, error);
+}
+
+int comms_collective_scatter(comms_collective_t *G,
+                             const void *send,
+                             size_t size,
+                             void *recv,
+                             uint32_t root,
+                             char **error) {
+    if (comms_collective_check(G, size, root, error)) return 1;
+    G->begin();
+    bool ok = G->scatter(static_cast<const uint8_t*>(send), size, static_cast<uint8_t*>(recv), root);
+    return comms_collective_finish(G, ok, error);
+}
+
+int comms_collective_allreduce(comms_collective_t *G,
+                               const void *send,
+                               void *recv,
+                               size_t count,
+                               int dtype,
+                               int op,
+                               char **error) {
+    comms_reduce_fn_t reduce = comms_reduce_kernel(dtype, op);
+    if (reduce == nullptr) {
+        std::stringstream ss;
+        ss << "Invalid all-reduce type or operator; Type provided: " << dtype << "; Operator provided: " << op;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    size_t element_size = comms_dtype_size(dtype);
+    size_t size = count*element_size;
+    if (comms_collective_check(G, size, 0, error)) return 1;
+
+    uint8_t *data = static_cast<uint8_t*>(recv);
+    if (send != recv) {
+        memmove(data, send, size);
+    }
+
+    int algorithm = G->C_->conf_.collective_allreduce;
+    if (algorithm == COMMS_ALLREDUCE_AUTO) {
+        algorithm = G->size_ > 2 and size/G->size_ >= COMMS_COLLECTIVE_RING_THRESHOLD
+                  ? COMMS_ALLREDUCE_RING : COMMS_ALLREDUCE_TREE;
+    }
+
+    G->begin();
+    bool ok = G->size_ == 1
+            or (algorithm == COMMS_ALLREDUCE_RING ? G->allreduce_ring(data, count, element_size, reduce)
+                                                  : G->allreduce_tree(data, count, element_size, reduce));
+    return comms_collective_finish(G, ok, error);
+}
@@ -0,0 +1,56 @@
+#include <algorithm>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+comms_dedup_stream_t::comms_dedup_stream_t()
+        : epoch_(0)
+        , highest_(0) {
+}
+
+// The window is kept in whole words of the bitmap.
+comms_dedup_t::comms_dedup_t(comms_t *C)
+        : window_((C->conf_.dedup_window + 63) / 64 * 64)
+        , streams_(C->conf_.end_point_capacity) {
+}
+
+int comms_dedup_t::check(uint32_t src,
+                         uint64_t epoch,
+                         uint64_t id) const {
+    const comms_dedup_stream_t& stream = streams_[src];
+    if (epoch != stream.epoch_ or id > stream.highest_) return COMMS_DEDUP_NEW;
+    if (id + window_ <= stream.highest_) return COMMS_DEDUP_STALE;
+
+    uint64_t bit = id % window_;
+    return (stream.seen_[bit / 64] >> (bit % 64)) & 1 ? COMMS_DEDUP_DUPLICATE : COMMS_DEDUP_NEW;
+}
+
+void comms_dedup_t::mark(uint32_t src,
+                         uint64_t epoch,
+                         uint64_t id) {
+    comms_dedup_stream_t& stream = streams_[src];
+    if (epoch != stream.epoch_) {
+        stream.epoch_ = epoch;
+        stream.highest_ = 0;
+        stream.seen_.assign(window_ / 64, 0);
+    }
+
+    // Slide the window up to id, forgetting the ids that drop out of it.
+    if (id > stream.highest_) {
+        if (id - stream.highest_ >= window_) {
+            std::fill(stream.seen_.begin(), stream.seen_.end(), 0);
+        }
+        else {
+            for (uint64_t next=stream.highest_+1; next<=id; next++) {
+                uint64_t bit = next % window_;
+                stream.seen_[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+            }
+        }
+        stream.highest_ = id;
+    }
+
+    uint64_t bit = id % window_;
+    stream.seen_[bit / 64] |= uint64_t(1) << (bit % 64);
+}
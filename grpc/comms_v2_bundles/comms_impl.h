@@ -6,6 +6,13 @@
 #include <memory>
 #include <vector>
 #include <thread>
+#include <random>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <map>
+#include <functional>
+#include <sched.h>
 #include <google/protobuf/arena.h>
 #include <grpcpp/grpcpp.h>
 
@@ -13,19 +20,62 @@
 #include "comms.pb.h"
 
 #include "concurrentqueue.h"
+#include "comms_ring.h"
 
 #define COMMS_BUNDLE_SIZE (4096)
 #define COMMS_SHORT_CIRCUIT (0)
 #define COMMS_USE_ASYNC_SERVICE
+#define COMMS_USE_TOKENS
+
+#define COMMS_CHANNEL_ROUND_ROBIN  (0)
+#define COMMS_CHANNEL_LEAST_LOADED (1)
+
+// Bundle payload codecs; the values go on the wire.
+#define COMMS_CODEC_NONE (0)
+#define COMMS_CODEC_LZ4  (1)
+#define COMMS_CODEC_ZSTD (2)
+
+// All-reduce algorithms: a ring for large vectors, a binomial tree (reduce,
+// then broadcast) for small ones, or picked by size.
+#define COMMS_ALLREDUCE_AUTO (0)
+#define COMMS_ALLREDUCE_RING (1)
+#define COMMS_ALLREDUCE_TREE (2)
+
+// Sentinel for gRPC tuning knobs that were never configured; those are left
+// at the gRPC default.
+#define COMMS_GRPC_DEFAULT (-1)
+
+// Thread placement. With COMMS_USE_NUMA (make COMMS_NUMA=1) queue memory is
+// bound to the NUMA node set by the innermost comms_numa_scope_t on the
+// allocating thread; otherwise it is left to first touch.
+bool comms_parse_cpus(const char *value, cpu_set_t *cpus);
+void comms_pin_thread(const cpu_set_t& cpus);
+int comms_numa_node_of(const cpu_set_t& cpus);
+int comms_numa_local_node();
+void *comms_numa_malloc(size_t size);
+void comms_numa_free(void *ptr);
+
+typedef struct comms_numa_scope_t {
+    int previous_;
+
+    comms_numa_scope_t(int node);
+    ~comms_numa_scope_t();
+} comms_numa_scope_t;
 
 struct CommsPacketTraits : public moodycamel::ConcurrentQueueDefaultTraits {
     static const size_t IMPLICIT_INITIAL_INDEX_SIZE = 256;
     static const size_t BLOCK_SIZE = 1024;
+
+    static inline void *malloc(size_t size) { return comms_numa_malloc(size); }
+    static inline void free(void *ptr) { comms_numa_free(ptr); }
 };
 
 struct CommsBundleTraits : public moodycamel::ConcurrentQueueDefaultTraits {
     static const size_t IMPLICIT_INITIAL_INDEX_SIZE = 256;
     static const size_t BLOCK_SIZE = 32;
+
+    static inline void *malloc(size_t size) { return comms_numa_malloc(size); }
+    static inline void free(void *ptr) { comms_numa_free(ptr); }
 };
 
 void comms_set_error(char **error, const char *str);
@@ -41,26 +91,291 @@ typedef struct config_t {
     size_t reader_buffer_size;
     size_t writer_retry_count;
     size_t writer_retry_delay;
+    size_t writer_retry_max_delay;
+    size_t writer_rpc_deadline;
+    uint32_t breaker_failure_threshold;
+    size_t breaker_reset_timeout;
+    uint32_t flow_control_window;
+    size_t flow_control_poll_interval;
     uint32_t writer_thread_count;
     uint32_t reader_thread_count;
     uint32_t arena_start_block_depth;
+    uint32_t channel_count;
+    int channel_policy;
+
+    // gRPC channel and server tuning.
+    int max_send_message_size;
+    int max_receive_message_size;
+    int http2_initial_window_size;
+    int http2_bdp_probe;
+    int keepalive_time;
+    int keepalive_timeout;
+    int keepalive_permit_without_calls;
+    int compression_algorithm;
+    int64_t resource_quota_memory;
+    int resource_quota_threads;
+    int reuse_port;
+
+    // Packet lifecycle tracing.
+    uint32_t trace_sample_period;
+    char *trace_file;
+
+    // Metrics exposition.
+    uint16_t metrics_port;
+    char *metrics_socket;
+
+    // CPUs each thread role may run on, empty for no pinning.
+    cpu_set_t writer_cpus;
+    cpu_set_t reader_cpus;
+    cpu_set_t receiver_cpus;
+
+    // Per-accessor rings to and from the writers, 0 to use the shared
+    // queues only.
+    size_t submit_ring_size;
+    size_t reap_ring_size;
+
+    // Bundle payload compression. In adaptive mode each end point keeps
+    // compressing only while the estimated transmit time saved exceeds the
+    // time spent compressing.
+    int bundle_codec;
+    int bundle_codec_level;
+    size_t bundle_codec_min_size;
+    int bundle_codec_adaptive;
+
+    // Lanes (bit per lane) whose bundles go through the writers' priority
+    // queue, closing at priority_bundle_size packets or at the end of each
+    // submit, whichever comes first.
+    uint64_t priority_lanes;
+    size_t priority_bundle_size;
+
+    // Lanes (bit per lane) with a catch queue of their own, caught only by
+    // accessors on the lane. Collectives run on such a lane.
+    uint64_t exclusive_lanes;
+    int collective_allreduce;
+    size_t collective_timeout;
+
+    // Lanes (bit per lane) delivered in order per sender. Bundles more than
+    // reorder_window ahead of the next expected one are refused for the
+    // sender to retry, and a gap still open after reorder_timeout ms is
+    // given up on.
+    uint64_t ordered_lanes;
+    size_t reorder_window;
+    size_t reorder_timeout;
+
+    // Bundles carry an id that is kept across retries, and receivers drop
+    // any id they have seen within the last dedup_window from that sender.
+    int exactly_once;
+    size_t dedup_window;
+
+    // Room for end points added at runtime. Everything kept per end point
+    // is sized for this many when comms starts or an accessor is created.
+    size_t end_point_capacity;
 
     config_t();
+    // The quota, if any, is shared by every channel and the server.
+    void apply(::grpc::ChannelArguments& args, ::grpc::ResourceQuota *quota) const;
+    void apply(::grpc::ServerBuilder& builder, ::grpc::ResourceQuota *quota) const;
     void destroy();
 } config_t;
 
+// Per-thread statistics. Each shard has a single writer, so updates are
+// plain relaxed load/store pairs; readers sum over all shards.
+#define COMMS_COUNTER_SUBMITTED_PACKETS   (0)
+#define COMMS_COUNTER_SUBMITTED_BYTES     (1)
+#define COMMS_COUNTER_TRANSMITTED_PACKETS (2)
+#define COMMS_COUNTER_TRANSMITTED_BYTES   (3)
+#define COMMS_COUNTER_RETRIED_PACKETS     (4)
+#define COMMS_COUNTER_FAILED_PACKETS      (5)
+#define COMMS_COUNTER_CAUGHT_PACKETS      (6)
+#define COMMS_COUNTER_RELEASED_PACKETS    (7)
+#define COMMS_COUNTER_COUNT               (8)
+
+extern const char *comms_counter_names[COMMS_COUNTER_COUNT];
+
+// Log-linear buckets with 8 sub-buckets per power of two, i.e. at most 12.5%
+// relative error, covering the full uint64_t range.
+#define COMMS_HISTOGRAM_SUB_BUCKETS (8)
+#define COMMS_HISTOGRAM_BUCKETS     (COMMS_HISTOGRAM_SUB_BUCKETS*62)
+
+typedef struct comms_histogram_t {
+    std::atomic<uint64_t> buckets_[COMMS_HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> max_;
+    std::atomic<uint64_t> sum_;
+
+    comms_histogram_t();
+    void record(uint64_t value, uint64_t count = 1);
+    void merge_into(std::vector<uint64_t>& buckets, uint64_t& max) const;
+    uint64_t sum() const;
+
+    static size_t bucket(uint64_t value);
+    static uint64_t bucket_value(size_t bucket);
+    static uint64_t percentile(const std::vector<uint64_t>& buckets, double fraction);
+} comms_histogram_t;
+
+typedef struct comms_stats_shard_t {
+    size_t end_point_count_;
+    int lane_count_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counters_;
+    comms_histogram_t transmit_latency_;
+    comms_histogram_t reap_latency_;
+
+    comms_stats_shard_t(size_t end_point_count, int lane_count);
+    inline void add(size_t end_point, uint32_t lane, int counter, uint64_t value) {
+        std::atomic<uint64_t>& slot = counters_[(end_point*lane_count_ + lane)*COMMS_COUNTER_COUNT + counter];
+        slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    uint64_t get(size_t end_point, uint32_t lane, int counter) const;
+} comms_stats_shard_t;
+
+int64_t comms_now_ns();
+
+// Hands packets back to the queue in their opaque field, in bulk enqueues per
+// run of packets bound for the same queue. The token, if any, is used for
+// runs bound for token_queue. Queues keep to the capacity they were created
+// with: a run that does not fit goes in as large a part as does and the rest
+// waits for the consumer. Only a consumer that makes no room for
+// COMMS_ENQUEUE_STALL_MS, such as one stopped at shutdown or the caller
+// itself, has the queue grow, so that the producer cannot hang.
+#define COMMS_ENQUEUE_STALL_MS (1000)
+
+void comms_enqueue_runs(comms_packet_t packet_list[],
+                        size_t packet_count,
+                        PacketQueue *token_queue = nullptr,
+                        moodycamel::ProducerToken *token = nullptr);
+
+// Lifecycle stages a sampled packet is timestamped at, in pipeline order.
+#define COMMS_TRACE_SUBMIT           (0)
+#define COMMS_TRACE_BUNDLE_CLOSE     (1)
+#define COMMS_TRACE_WRITER_DEQUEUE   (2)
+#define COMMS_TRACE_RPC_START        (3)
+#define COMMS_TRACE_RPC_FINISH       (4)
+#define COMMS_TRACE_RECEIVER_ARRIVAL (5)
+#define COMMS_TRACE_CATCH            (6)
+#define COMMS_TRACE_RELEASE          (7)
+#define COMMS_TRACE_STAGE_COUNT      (8)
+
+// Sampled packets per bundle that carry a trace, and traces kept in total.
+// Samples beyond either limit are dropped.
+#define COMMS_TRACE_BUNDLE_SLOTS (8)
+#define COMMS_TRACE_CAPACITY     (1<<16)
+
+typedef struct comms_trace_t {
+    int64_t stamps_[COMMS_TRACE_STAGE_COUNT];
+    uint32_t lane_;
+} comms_trace_t;
+
+// Timestamps of sampled packets, kept off the packet in a table keyed by
+// tag. Whether a packet is sampled depends only on its tag, so unsampled
+// packets cost a single branch on sample_period_ and bundles carry the
+// indices of their sampled packets from there on.
+typedef struct comms_tracer_t {
+    uint32_t sample_period_;
+    int64_t origin_;
+    std::mutex mtx_;
+    std::unordered_map<uint64_t, comms_trace_t> traces_;
+
+    comms_tracer_t();
+    bool sampled(uint64_t tag) const;
+    void stamp(uint64_t tag, uint32_t lane, int stage);
+    void stamp(comms_bundle_t& bundle, int stage);
+    std::string chrome_json(size_t pid);
+} comms_tracer_t;
+
+// Packets within a bundle are stored as parallel arrays. Everything the
+// packets of one bundle have in common (destination or source, return code
+// and the opaque queue pointer) is kept once per bundle, so building a
+// bundle touches only the per-packet columns and stamping a return code is
+// a single store. The AoS comms_packet_t form is produced on the way out.
+#define COMMS_BUNDLE_GATHER_SIZE (256)
+
+typedef struct comms_broadcast_t comms_broadcast_t;
+
 typedef struct comms_bundle_t {
     size_t size_;
-    comms_packet_t packet_list_[COMMS_BUNDLE_SIZE];
+    uint32_t dst_;
+    uint32_t src_;
+    uint32_t lane_;
+    uint32_t rc_;
+    bool charged_;
+    uint64_t bytes_;
+    int64_t opened_at_;
+    void *opaque_;
+    comms_broadcast_t *broadcast_;
+    uint64_t sequence_;
+    uint64_t id_;
+    uint32_t trace_count_;
+    uint16_t trace_index_[COMMS_TRACE_BUNDLE_SLOTS];
+    uint32_t size_list_[COMMS_BUNDLE_SIZE];
+    uint64_t tag_list_[COMMS_BUNDLE_SIZE];
+    uint8_t *payload_list_[COMMS_BUNDLE_SIZE];
 
     comms_bundle_t();
     void add(const comms_packet_t& packet);
+    void add(uint32_t size, uint64_t tag, uint8_t *payload);
+    void add_n(const comms_packet_t packet_list[], size_t packet_count);
+    void add_n(const comms_packet_t packet_list[], const uint32_t index_list[], size_t packet_count);
     size_t size() const;
+    uint32_t dst() const;
+    uint32_t lane() const;
     void clear();
-    comms_packet_t *packet_list();
     void set_reap_rc(int rc);
+    size_t gather_reaped(comms_packet_t packet_list[], size_t first, size_t count) const;
+    size_t gather_caught(comms_packet_t packet_list[], size_t first, size_t count) const;
+    void reap(int rc, comms_ring_t<comms_packet_t> *reap_ring = nullptr);
+    bool trace(size_t index);
 } comms_bundle_t;
 
+// A packet list going to several end points. It is serialized once into
+// message_, whose slices every destination's RPC shares; each destination
+// gets an ordinary bundle pointing here for credit, retries and stats. The
+// last of those bundles to be reaped reaps the packets with the first
+// failure code and frees the broadcast.
+typedef struct comms_broadcast_t {
+    ::grpc::ByteBuffer message_;
+    std::atomic<size_t> remaining_;
+    std::atomic<int> rc_;
+    // Set by the first destination reaped as not drained, so that the
+    // packets are counted as undrained once.
+    std::atomic_bool undrained_;
+
+    comms_broadcast_t(size_t dst_count);
+    bool complete(int rc);
+} comms_broadcast_t;
+
+// Idle submit bundles shared by all accessors of a comms object. Accessors
+// take a bundle the first time they submit to a destination and give it back
+// once it has been flushed, so bundle memory follows the destinations in use
+// rather than the size of the cluster. At most COMMS_BUNDLE_POOL_SIZE idle
+// bundles are kept.
+#define COMMS_BUNDLE_POOL_SIZE (64)
+
+typedef struct comms_bundle_pool_t {
+    std::mutex mtx_;
+    std::vector<comms_bundle_t*> bundles_;
+
+    ~comms_bundle_pool_t();
+    comms_bundle_t *acquire();
+    void release(comms_bundle_t *bundle);
+} comms_bundle_pool_t;
+
+// Payloads of a received bundle live in one allocation headed by this block.
+// Each payload is preceded by a pointer back to the block so that a released
+// packet finds its block without a lookup.
+typedef struct comms_catch_block_t {
+    std::atomic<size_t> refs_;
+    uint32_t src_;
+    uint32_t lane_;
+    bool traced_;
+
+    static comms_catch_block_t *create(const ::comms::PacketBundle& request,
+                                       const uint8_t *payloads,
+                                       comms_bundle_t& bundle,
+                                       PacketQueue *release_queue);
+    static comms_catch_block_t *from_payload(uint8_t *payload);
+    bool unref(size_t count);
+    void destroy();
+} comms_catch_block_t;
+
 typedef struct comms_reader_t {
     comms_t *C_;
 
@@ -74,6 +389,7 @@ typedef struct comms_reader_t {
     std::condition_variable shutdown_cv_;
 
     std::shared_ptr<std::thread> thread_;
+    std::shared_ptr<comms_stats_shard_t> stats_;
 
     comms_reader_t(comms_t *C);
     void start();
@@ -90,7 +406,81 @@ public:
                         ::comms::PacketResponse *response) override;
 };
 
+// Restores the send order of bundles on ordered lanes, one stream per
+// (source, lane). Bundles ahead of the next expected sequence number wait in
+// a copy taken from the bundle pool, at most reorder_window sequence
+// numbers ahead; further ones are refused and retried by the sender. A gap
+// left by a bundle that never arrives is skipped once it has been open for
+// reorder_timeout ms, or as soon as the sender says it gave up on that
+// bundle, and a bundle arriving after its gap was skipped is delivered as it
+// comes. A stream starts at 1 if the first sequence number
+// it sees is within the window, and at that number otherwise. It starts
+// over when the numbers drop back by more than the window, as they do when
+// the sender restarts. Used by the receiver thread only.
+#define COMMS_REORDER_ACCEPTED  (0)
+#define COMMS_REORDER_FULL      (1)
+#define COMMS_REORDER_DUPLICATE (2)
+
+// Receiver wake-up interval for gap timeouts while bundles are waiting.
+#define COMMS_REORDER_TICK_MS   (10)
+
+typedef struct comms_reorder_stream_t {
+    uint64_t next_;
+    int64_t stalled_at_;
+    std::map<uint64_t, comms_bundle_t*> pending_;
+
+    comms_reorder_stream_t();
+} comms_reorder_stream_t;
+
+typedef struct comms_reorder_t {
+    comms_t *C_;
+    int lane_count_;
+    uint64_t window_;
+    int64_t timeout_ns_;
+    size_t pending_count_;
+    std::vector<comms_reorder_stream_t> streams_;
+
+    comms_reorder_t(comms_t *C);
+    ~comms_reorder_t();
+    // A null bundle is a skip: the sender gave up on that sequence number.
+    int arrive(uint32_t src, uint32_t lane, uint64_t sequence, comms_bundle_t *bundle);
+    void expire();
+    void drain(comms_reorder_stream_t& stream);
+} comms_reorder_t;
+
+// Recognises retried bundles that were already delivered under exactly-once
+// delivery. Each sender has a bitmap over the dedup_window ids up to the
+// highest one delivered under its current epoch. An id that has fallen
+// below the window can no longer be told apart and is refused rather than
+// risk delivering it twice. A new epoch starts the sender over. Used by the
+// receiver thread only.
+#define COMMS_DEDUP_NEW       (0)
+#define COMMS_DEDUP_DUPLICATE (1)
+#define COMMS_DEDUP_STALE     (2)
+
+typedef struct comms_dedup_stream_t {
+    uint64_t epoch_;
+    uint64_t highest_;
+    std::vector<uint64_t> seen_;
+
+    comms_dedup_stream_t();
+} comms_dedup_stream_t;
+
+typedef struct comms_dedup_t {
+    uint64_t window_;
+    std::vector<comms_dedup_stream_t> streams_;
+
+    comms_dedup_t(comms_t *C);
+    int check(uint32_t src, uint64_t epoch, uint64_t id) const;
+    void mark(uint32_t src, uint64_t epoch, uint64_t id);
+} comms_dedup_t;
+
+// Inflated payload buffer the receiver keeps between compressed bundles.
+#define COMMS_RECEIVER_PAYLOADS_KEEP (1<<20)
+
 typedef struct comms_receiver_t {
+    comms_t *C_;
+
     std::atomic_bool started_;
     std::mutex started_mtx_;
     std::condition_variable started_cv_;
@@ -105,19 +495,27 @@ typedef struct comms_receiver_t {
     std::shared_ptr<std::thread> thread_;
     std::unique_ptr<::grpc::Server> server_;
 
+#ifdef COMMS_USE_TOKENS
+    // Owned by the receiver thread, valid while it runs.
+    moodycamel::ProducerToken *catch_token_;
+#endif
+    comms_reorder_t reorder_;
+    comms_dedup_t dedup_;
+
 #ifdef COMMS_USE_ASYNC_SERVICE
     ::comms::Comms::AsyncService service_;
     std::unique_ptr<::grpc::ServerCompletionQueue> cq_;
 
     class CallData {
     public:
-        CallData(::comms::Comms::AsyncService *service,
+        CallData(comms_t *C,
+                 ::comms::Comms::AsyncService *service,
                  ::grpc::ServerCompletionQueue *cq);
 
         void Proceed();
 
     private:
-        char *buffer_;
+        comms_t *C_;
         std::unique_ptr<::google::protobuf::Arena> arena_;
         ::comms::Comms::AsyncService *service_;
         ::grpc::ServerCompletionQueue *cq_;
@@ -132,16 +530,61 @@ typedef struct comms_receiver_t {
     CommsSyncServiceImpl service_;
 #endif
 
-    comms_receiver_t(std::vector<std::shared_ptr<comms_reader_t>>& readers);
+    comms_receiver_t(comms_t *C,
+                     std::vector<std::shared_ptr<comms_reader_t>>& readers);
     void start(std::string address);
     void run(std::string address);
     void wait_for_start();
     void shutdown();
     void wait_for_shutdown();
+    bool deposit(comms_bundle_t& bundle);
 } comms_receiver_t;
 
+// The accessor side of the accessor-to-writer handoff. Each accessor is
+// assigned one writer for its lifetime, so both rings keep a single producer
+// and a single consumer.
+typedef struct comms_accessor_rings_t {
+    size_t writer_;
+    comms_ring_t<comms_bundle_t> submit_;
+    comms_ring_t<comms_packet_t> reap_;
+
+    comms_accessor_rings_t(size_t submit_size, size_t reap_size);
+} comms_accessor_rings_t;
+
+// A sequence number on an ordered lane whose bundle was given up on. A
+// writer sends it to the destination as an empty bundle carrying that
+// number, so that the bundles after it are not held for the reorder timeout.
+typedef struct comms_skip_t {
+    uint32_t dst_;
+    uint32_t lane_;
+    uint64_t sequence_;
+} comms_skip_t;
+
+// Skips are retried at least this many times whatever writer_retry_count
+// says, since a lost skip holds its lane up for the reorder timeout.
+#define COMMS_SKIP_RETRY_COUNT (16)
+
+// A bundle taken from an accessor ring keeps the accessor's rings alive
+// until it is reaped, even if the accessor is destroyed in the meantime.
+typedef struct comms_retry_t {
+    std::chrono::steady_clock::time_point due_;
+    size_t attempt_;
+    int rc_;
+    std::unique_ptr<comms_bundle_t> bundle_;
+    std::shared_ptr<comms_accessor_rings_t> rings_;
+
+    // Orders the retry heap so the earliest deadline is on top.
+    bool operator<(const comms_retry_t& other) const;
+} comms_retry_t;
+
+// Shared queues a writer takes bundles from.
+#define COMMS_WRITER_QUEUE_PRIORITY (0)
+#define COMMS_WRITER_QUEUE_SUBMIT   (1)
+#define COMMS_WRITER_QUEUE_COUNT    (2)
+
 typedef struct comms_writer_t {
     comms_t *C_;
+    size_t index_;
 
     std::atomic_bool started_;
     std::mutex started_mtx_;
@@ -154,44 +597,256 @@ typedef struct comms_writer_t {
 
     std::shared_ptr<std::thread> thread_;
 
-    comms_writer_t(comms_t *C);
+    // Bundles waiting out their backoff, only touched by the writer thread.
+    std::vector<comms_retry_t> retries_;
+
+    // A bundle from a shared queue whose lane has no credit is parked, one
+    // per (dst, lane). A second one for a parked lane is held for its queue,
+    // and nothing more is taken from that queue until the lane has credit,
+    // so the queue fills and submitters are pushed back. Ring bundles stay
+    // in their slot instead.
+    std::map<std::pair<uint32_t,uint32_t>,std::unique_ptr<comms_bundle_t>> parked_;
+    std::unique_ptr<comms_bundle_t> held_[COMMS_WRITER_QUEUE_COUNT];
+    std::mt19937 rng_;
+    std::shared_ptr<comms_stats_shard_t> stats_;
+
+    // Rings of the accessors assigned to this writer, refreshed whenever
+    // comms_t::rings_version_ moves.
+    std::vector<std::shared_ptr<comms_accessor_rings_t>> rings_;
+    uint64_t rings_version_;
+
+    comms_writer_t(comms_t *C, size_t index);
+    void refresh_rings();
     void start(std::shared_ptr<comms_receiver_t> receiver);
     void run(std::shared_ptr<comms_receiver_t> receiver);
+    bool dispatch(comms_bundle_t& bundle, std::unique_ptr<comms_bundle_t>& owned, size_t attempt,
+                  const std::shared_ptr<comms_accessor_rings_t>& rings);
+    void dispatch_queued(int queue, comms_bundle_t& bundle);
+    bool resume_parked();
+    bool resume_held(int queue);
+    size_t backoff(size_t attempt);
+    size_t retry_count(const comms_bundle_t& bundle) const;
+    void defer(comms_bundle_t& bundle, std::unique_ptr<comms_bundle_t> owned, size_t attempt, int rc, size_t delay,
+               const std::shared_ptr<comms_accessor_rings_t>& rings);
+    void reap(comms_bundle_t& bundle, int rc, const std::shared_ptr<comms_accessor_rings_t>& rings);
+    void reap_undrained(bool shared_queues);
+    void take_skips();
     void shutdown();
     void wait_for_shutdown();
 } comms_writer_t;
 
+bool comms_codec_available(int codec);
+size_t comms_codec_bound(int codec, size_t size);
+size_t comms_codec_compress(int codec, int level, const uint8_t *src, size_t size,
+                            uint8_t *dst, size_t capacity);
+bool comms_codec_decompress(int codec, const uint8_t *src, size_t size,
+                            uint8_t *dst, size_t capacity);
+
+// Per-peer running estimates behind adaptive compression: the compression
+// ratio and cost of recent bundles and what a byte costs on the wire to this
+// peer. Updates from concurrent writers may race; the estimates are
+// smoothed, so a lost sample does not matter.
+#define COMMS_CODEC_WARMUP         (16)
+#define COMMS_CODEC_PROBE_INTERVAL (64)
+
+typedef struct comms_codec_policy_t {
+    std::atomic<double> ratio_;
+    std::atomic<double> compress_ns_per_byte_;
+    std::atomic<double> wire_ns_per_byte_;
+    std::atomic<uint64_t> bundles_;
+
+    comms_codec_policy_t();
+    bool compress();
+    void record_compression(size_t size, size_t compressed_size, int64_t elapsed_ns);
+    void record_transmit(size_t wire_size, int64_t elapsed_ns);
+} comms_codec_policy_t;
+
 class EndPoint {
 public:
     EndPoint() = delete;
     EndPoint(comms_end_point_t *end_point,
              size_t end_point_id,
-             bool is_local,
-             std::shared_ptr<BundleQueue> deposit_queue,
+             size_t local_id,
+             int lane_count,
              uint32_t arena_start_block_depth = 1<<20);
 
     void set_arena_start_block_size(size_t block_size);
+    void set_deposit_queue(std::shared_ptr<BundleQueue> deposit_queue);
+    void create_channels(const config_t& conf, ::grpc::ResourceQuota *quota);
 
-    bool deposit_n(comms_bundle_t& bundle);
+    void set_priority_queue(std::shared_ptr<BundleQueue> priority_queue);
+
+    bool deposit_n(comms_bundle_t& bundle, bool priority = false);
+    bool deposit_n(comms_bundle_t& bundle, moodycamel::ProducerToken& token, bool priority = false);
+    BundleQueue *deposit_queue(bool priority = false) const;
     void release_n(comms_bundle_t& bundle);
-    bool transmit_n(comms_bundle_t& bundle,
-                    size_t retry_count,
-                    size_t retry_delay);
+    int transmit_n(comms_bundle_t& bundle,
+                   size_t deadline);
     bool is_local() const;
+    const std::string& name() const;
+
+    bool available(bool& trial);
+    void end_trial();
+    bool probe();
+    void health(comms_end_point_health_t *health) const;
+
+    // Sender side of flow control: credit granted by this peer.
+    bool acquire_credit(uint32_t lane);
+    void refund_credit(uint32_t lane);
+    void poll_credit(uint32_t lane, size_t deadline);
+
+    // Receiver side of flow control: credit this process grants the peer.
+    void release(uint32_t lane);
+    uint64_t credit_limit(uint32_t lane) const;
+
+    // Sequence number of the next bundle to this peer on an ordered lane.
+    uint64_t next_sequence(uint32_t lane);
+
+    // Id of the next bundle to this peer under exactly-once delivery.
+    uint64_t next_bundle_id();
+
+    // A removed peer keeps its index; bundles still bound for it are reaped
+    // with COMMS_PEER_REMOVED and bundles from it are refused. Its channels
+    // are let go once the last call using them returns.
+    void remove();
+    bool removed() const;
 
 private:
     std::string name_;
     std::string address_;
     size_t id_;
+    size_t local_id_;
     bool is_local_;
-    std::unique_ptr<::comms::Comms::Stub> stub_;
+    std::vector<std::shared_ptr<::grpc::Channel>> channels_;
+    std::vector<std::unique_ptr<::comms::Comms::Stub>> stubs_;
+    std::unique_ptr<std::atomic<size_t>[]> in_flight_;
+    std::atomic<size_t> next_channel_;
+    int channel_policy_;
     std::shared_ptr<BundleQueue> deposit_queue_;
+    std::shared_ptr<BundleQueue> priority_queue_;
     size_t arena_start_block_size_;
 
+    // Circuit breaker and health tracking.
+    std::atomic<int> breaker_state_;
+    std::atomic<uint32_t> consecutive_failures_;
+    std::atomic<int64_t> breaker_opened_at_;
+    // Set while a half open breaker's trial bundle is out.
+    std::atomic_bool trial_in_flight_;
+    std::atomic<uint64_t> latency_us_;
+    std::atomic<uint64_t> success_count_;
+    std::atomic<uint64_t> failure_count_;
+    uint32_t breaker_failure_threshold_;
+    size_t breaker_reset_timeout_;
+
+    // Flow control, one counter per lane.
+    int lane_count_;
+    uint32_t flow_control_window_;
+    size_t flow_control_poll_interval_;
+    std::unique_ptr<std::atomic<uint64_t>[]> credit_sent_;
+    std::unique_ptr<std::atomic<uint64_t>[]> credit_limit_;
+    std::unique_ptr<std::atomic<uint64_t>[]> released_;
+    std::unique_ptr<std::atomic<int64_t>[]> last_credit_poll_;
+    std::unique_ptr<std::atomic<uint64_t>[]> sequence_;
+
+    std::atomic_bool removed_;
+    // Calls using the channels right now. Whoever takes it to zero after
+    // the removal releases the channels.
+    std::atomic<size_t> channel_users_;
+    std::atomic_bool channels_released_;
+
+    // Exactly-once delivery: a fresh epoch each time comms starts.
+    bool exactly_once_;
+    uint64_t epoch_;
+    std::atomic<uint64_t> bundle_id_;
+
+    // Bundle compression.
+    int codec_;
+    int codec_level_;
+    size_t codec_min_size_;
+    bool codec_adaptive_;
+    comms_codec_policy_t codec_policy_;
+
+    bool compress(const comms_bundle_t& bundle, ::comms::PacketBundle& packet_bundle);
+    // Method handles for sending pre-serialized bundles, one per channel.
+    std::vector<std::unique_ptr<::grpc::internal::RpcMethod>> send_methods_;
+
+    void grant_credit(uint32_t lane, uint64_t limit);
+    void record(int rc, uint64_t latency_us);
+    bool enter();
+    void leave();
+    void release_channels();
+    bool acquire_channel(size_t& channel);
+    void release_channel(size_t channel);
     ::grpc::Status send_packets_internal(::comms::PacketBundle& packets,
-                                         ::comms::PacketResponse& response);
+                                         ::comms::PacketResponse& response,
+                                         size_t deadline);
+    ::grpc::Status send_message_internal(const ::grpc::ByteBuffer& message,
+                                         ::comms::PacketResponse& response,
+                                         size_t deadline);
 };
 
+// Packets comms_catch_matching took off a catch queue without a match:
+// MPI's unexpected-message list, shared by every accessor catching from that
+// queue. Packets are hashed by tag into buckets, each a FIFO under its own
+// lock, so a lookup for an exact tag touches one bucket and sees that tag's
+// packets in arrival order, while a masked lookup visits the non-empty
+// buckets. An empty matcher costs a single load.
+#define COMMS_MATCH_BUCKETS (64)
+
+typedef struct comms_match_bucket_t {
+    std::mutex mtx_;
+    std::vector<comms_packet_t> packets_;
+    std::atomic<size_t> size_;
+
+    comms_match_bucket_t();
+} comms_match_bucket_t;
+
+typedef struct comms_matcher_t {
+    comms_match_bucket_t buckets_[COMMS_MATCH_BUCKETS];
+    std::atomic<size_t> size_;
+
+    comms_matcher_t();
+    static size_t bucket(uint64_t tag);
+    void put(const comms_packet_t packet_list[], size_t packet_count);
+    size_t take(uint64_t tag, uint64_t mask, comms_packet_t packet_list[], size_t packet_count);
+} comms_matcher_t;
+
+typedef struct comms_metrics_source_entry_t {
+    comms_metrics_source_t source_;
+    void *context_;
+} comms_metrics_source_entry_t;
+
+// Serves Prometheus text exposition over HTTP on a TCP port and/or a Unix
+// socket. Scrapes are rare, so a single thread polls the listeners and
+// answers one connection at a time.
+typedef struct comms_metrics_t {
+    comms_t *C_;
+    std::atomic_bool shutting_down_;
+    std::vector<int> listeners_;
+    std::string socket_path_;
+    std::shared_ptr<std::thread> thread_;
+
+    std::mutex sources_mtx_;
+    std::vector<comms_metrics_source_entry_t> sources_;
+
+    comms_metrics_t(comms_t *C);
+    bool start(uint16_t port, const char *socket_path);
+    void run();
+    void serve(int fd);
+    void add_source(comms_metrics_source_t source, void *context);
+    std::string text();
+    void shutdown();
+} comms_metrics_t;
+
+// The end points by index. A table is never modified once published:
+// readers load the current one without locking and a membership change
+// publishes an amended copy. Replaced tables are kept until comms is
+// destroyed since readers may still be using them; changes are rare and
+// tables small.
+typedef struct comms_end_point_table_t {
+    std::vector<std::shared_ptr<EndPoint>> end_points_;
+} comms_end_point_table_t;
+
 typedef struct comms_t {
     config_t conf_;
     int lane_count_;
@@ -205,6 +860,18 @@ typedef struct comms_t {
     std::mutex shutdown_mtx_;
     std::condition_variable shutdown_cv_;
 
+    // A drain stops submits, flushes the accessors and has the writers send
+    // what is queued until the deadline, then shuts down. Packets left over
+    // are reaped with COMMS_NOT_DRAINED and counted.
+    std::atomic_bool draining_;
+    std::atomic<int64_t> drain_deadline_ns_;
+    std::atomic<uint64_t> undrained_packets_;
+
+    // Sequence numbers given up on, for whichever writer looks first.
+    std::mutex skips_mtx_;
+    std::vector<comms_skip_t> skips_;
+    std::atomic<size_t> skip_count_;
+
     std::vector<std::shared_ptr<comms_reader_t>> readers_;
     std::vector<std::thread> reader_threads_;
 
@@ -214,10 +881,41 @@ typedef struct comms_t {
     std::vector<std::thread> writer_threads_;
 
     std::shared_ptr<BundleQueue> submit_queue_;
+    std::shared_ptr<BundleQueue> priority_queue_;
     std::shared_ptr<BundleQueue> catch_queue_;
+    std::vector<std::shared_ptr<BundleQueue>> lane_catch_queues_;
+    comms_matcher_t matcher_;
+    std::vector<std::unique_ptr<comms_matcher_t>> lane_matchers_;
+    std::shared_ptr<PacketQueue> release_queue_;
 
-    std::vector<EndPoint> end_points_;
+    std::atomic<const comms_end_point_table_t*> end_point_table_;
+    std::mutex membership_mtx_;
+    std::vector<std::unique_ptr<comms_end_point_table_t>> end_point_tables_;
+    bool connected_;
     size_t local_index_;
+    // Moves on every add or remove, so collectives can tell their ranks
+    // are out of date.
+    std::atomic<uint64_t> membership_version_;
+
+    // Live accessors and the stats shards, guarded by stats_mtx_. Only the
+    // slow paths take the lock. The shard of a destroyed accessor is idle
+    // until the next accessor takes it over, so counts are kept without a
+    // shard for every accessor ever created.
+    std::mutex stats_mtx_;
+    std::vector<comms_accessor_t*> accessors_;
+    std::vector<std::shared_ptr<comms_accessor_rings_t>> rings_;
+    std::atomic<uint64_t> rings_version_;
+    size_t next_ring_writer_;
+    std::vector<std::shared_ptr<comms_stats_shard_t>> stats_shards_;
+    std::vector<std::shared_ptr<comms_stats_shard_t>> idle_stats_shards_;
+
+    // One gRPC resource quota for all channels and the server, created at
+    // start when resource-quota-memory or resource-quota-threads is set.
+    std::unique_ptr<::grpc::ResourceQuota> resource_quota_;
+
+    comms_bundle_pool_t bundle_pool_;
+    comms_tracer_t tracer_;
+    comms_metrics_t metrics_;
 
     comms_t(comms_end_point_t *end_point_list,
             size_t end_point_count,
@@ -227,31 +925,230 @@ typedef struct comms_t {
     bool wait_for_start(double timeout);
     bool wait_for_shutdown(double timeout);
     void shutdown();
+    bool drain(double timeout);
+    bool drain_expired() const;
+    void skip(const comms_bundle_t& bundle);
+    void take_skips(std::vector<comms_skip_t>& skips);
     void destroy();
+    void create_queues();
+    void create_lane_queues();
+    void bind(EndPoint& end_point, size_t index);
+    const std::vector<std::shared_ptr<EndPoint>>& end_points() const;
+    void publish(std::unique_ptr<comms_end_point_table_t> table);
+    void connect(EndPoint& end_point);
+    bool priority_lane(int lane) const;
+    bool exclusive_lane(int lane) const;
+    bool ordered_lane(int lane) const;
+    BundleQueue *catch_queue(uint32_t lane) const;
+    comms_matcher_t& matcher(uint32_t lane);
+
+    std::shared_ptr<comms_stats_shard_t> create_stats_shard();
+    void attach(comms_accessor_t *A);
+    void detach(comms_accessor_t *A);
+    void stats(int end_point, int lane, comms_stats_t *stats);
+    std::string stats_json();
+    bool trace_dump(const char *path);
+    std::string metrics_text();
 } comms_t;
 
+// Groups a submitted packet list by destination with a counting sort:
+// destinations are extracted (with AVX2 where the CPU has it), counted, and
+// the packet indices laid out grouped by destination, keeping submission
+// order within each group. A list bound for a single destination skips the
+// sort. Counts are reset after each run so the cost follows the packet
+// count rather than the number of end points. When groups would average
+// fewer than COMMS_PARTITION_MIN_GROUP packets the list is left ungrouped
+// (sparse), since sorting costs more than it saves.
+#define COMMS_PARTITION_MIN_GROUP (4)
+
+typedef struct comms_partition_t {
+    std::vector<uint32_t> count_list_;
+    std::vector<uint32_t> dst_list_;
+    std::vector<uint32_t> index_list_;
+    std::vector<uint32_t> touched_;
+    std::vector<uint32_t> start_list_;
+    bool uniform_;
+    bool sparse_;
+
+    comms_partition_t(size_t end_point_count);
+    void run(const comms_packet_t packet_list[],
+             size_t packet_count);
+    size_t group_count() const;
+    uint32_t group_dst(size_t group) const;
+    size_t group_size(size_t group) const;
+    const uint32_t *group_index_list(size_t group) const;
+} comms_partition_t;
+
+// Copies dst out of each packet, returning true if they are all the same.
+bool comms_extract_dst(const comms_packet_t packet_list[],
+                       size_t packet_count,
+                       uint32_t dst_list[]);
+bool comms_extract_dst_scalar(const comms_packet_t packet_list[],
+                              size_t packet_count,
+                              uint32_t dst_list[]);
+
+// Payload buffers for one accessor, carved from slabs of equal-sized
+// blocks with a free list per power-of-two size class from
+// 1<<COMMS_PAYLOAD_MIN_SHIFT to 1<<COMMS_PAYLOAD_MAX_SHIFT bytes; larger
+// payloads get a slab of their own. Slabs stay with the pool until the
+// accessor is destroyed, so it settles at the application's peak and then
+// stops allocating. Slabs are looked up by address, which is how reaping
+// tells the pool's payloads from the application's own. Used by the
+// accessor's thread only.
+#define COMMS_PAYLOAD_MIN_SHIFT (6)
+#define COMMS_PAYLOAD_MAX_SHIFT (20)
+#define COMMS_PAYLOAD_SLAB_SIZE (1<<16)
+
+typedef struct comms_payload_slab_t {
+    uint8_t *base_;
+    size_t block_size_;
+    size_t block_count_;
+    int size_class_;    // -1 for a dedicated slab
+    std::vector<uint64_t> allocated_;
+    std::vector<uint64_t> recycle_;
+
+    comms_payload_slab_t(size_t block_size, size_t block_count, int size_class);
+    ~comms_payload_slab_t();
+} comms_payload_slab_t;
+
+typedef struct comms_payload_block_t {
+    comms_payload_slab_t *slab_;
+    size_t index_;
+} comms_payload_block_t;
+
+typedef struct comms_payload_pool_t {
+    std::vector<std::vector<comms_payload_block_t>> free_lists_;
+    std::map<uintptr_t, std::unique_ptr<comms_payload_slab_t>> slabs_;
+    size_t recycle_count_;
+
+    comms_payload_pool_t();
+    uint8_t *alloc(size_t size, bool recycle);
+    bool free(uint8_t *payload);
+    void recycle(comms_packet_t packet_list[], size_t packet_count);
+    bool find(const uint8_t *payload, comms_payload_block_t *block) const;
+} comms_payload_pool_t;
+
 typedef struct comms_accessor_t {
     comms_t *C_;
     int lane_;
-    size_t end_point_count_;
+    bool priority_;
+    bool ordered_;
     size_t buffer_size_;
-    std::vector<comms_bundle_t> submit_bundles_;
+    // Bundles are taken from the comms bundle pool on first use; dirty_ has a
+    // bit set for each destination with a non-empty bundle.
+    std::vector<comms_bundle_t*> submit_bundles_;
+    std::vector<uint64_t> dirty_;
+    comms_partition_t partition_;
     std::shared_ptr<PacketQueue> reap_queue_;
+    std::shared_ptr<comms_accessor_rings_t> rings_;
     PacketQueue catch_queue_;
+    std::shared_ptr<comms_stats_shard_t> stats_;
+    comms_payload_pool_t payloads_;
+
+    // Set for the duration of a submit call, so that a drain on another
+    // thread can wait it out before flushing the accessor.
+    std::atomic_bool submitting_;
+
+#ifdef COMMS_USE_TOKENS
+    // Tokens are created on first use, for the queues the accessor actually
+    // uses. An accessor is used by one thread at a time.
+    std::vector<std::pair<BundleQueue*,std::unique_ptr<moodycamel::ProducerToken>>> deposit_tokens_;
+    std::unique_ptr<moodycamel::ConsumerToken> catch_token_;
+    std::unique_ptr<moodycamel::ProducerToken> release_token_;
+    std::unique_ptr<moodycamel::ConsumerToken> reap_token_;
+
+    moodycamel::ProducerToken& deposit_token(BundleQueue *queue);
+#endif
 
     comms_accessor_t(comms_t *C,
                      int lane);
+    ~comms_accessor_t();
+
+    // The accessor owns its submit bundles, so it is not copied.
+    comms_accessor_t(const comms_accessor_t&) = delete;
+    comms_accessor_t& operator=(const comms_accessor_t&) = delete;
+
+    comms_bundle_t& submit_bundle(uint32_t dst);
 
     void submit_n(comms_packet_t packet_list[],
                   size_t packet_count);
+    void submit_broadcast_n(comms_packet_t packet_list[],
+                            size_t packet_count,
+                            const uint32_t dst_list[],
+                            size_t dst_count);
     size_t reap_n(comms_packet_t packet_list[],
                   size_t packet_count);
     size_t catch_n(comms_packet_t packet_list[],
                    size_t packet_count);
+    size_t catch_matching_n(uint64_t tag,
+                            uint64_t mask,
+                            comms_packet_t packet_list[],
+                            size_t packet_count);
     void release_n(comms_packet_t packet_list[],
                    size_t packet_count);
 
     size_t submit_flush();
 } comms_accessor_t;
 
+// Marks the accessor as submitting and tells whether comms still takes
+// packets. Checked after the mark, so a drain either sees the call or the
+// call sees the drain.
+typedef struct comms_submit_scope_t {
+    comms_accessor_t *A_;
+
+    comms_submit_scope_t(comms_accessor_t *A);
+    ~comms_submit_scope_t();
+    bool open() const;
+} comms_submit_scope_t;
+
+// Collectives move messages as chunks of at most COMMS_COLLECTIVE_CHUNK_SIZE
+// bytes, flushed every COMMS_COLLECTIVE_BUNDLE_CHUNKS chunks so bundles stay
+// well below gRPC's default message size limit. A chunk's tag holds the
+// operation's sequence number, the step within the operation and the chunk
+// index; chunks caught ahead of the step that wants them wait in
+// unexpected_, keyed by source and tag. Sent buffers belong to the caller,
+// so every operation reaps all of its packets before returning.
+#define COMMS_COLLECTIVE_CHUNK_SIZE      (1<<16)
+#define COMMS_COLLECTIVE_BUNDLE_CHUNKS   (16)
+#define COMMS_COLLECTIVE_MAX_CHUNKS      (1<<16)
+#define COMMS_COLLECTIVE_RING_THRESHOLD  (1<<16)
+
+typedef void (*comms_reduce_fn_t)(void *dst, const void *src, size_t count);
+comms_reduce_fn_t comms_reduce_kernel(int dtype, int op);
+size_t comms_dtype_size(int dtype);
+
+typedef struct comms_collective_t {
+    typedef std::function<void(size_t offset, const uint8_t *payload, size_t size)> consumer_t;
+
+    comms_t *C_;
+    comms_accessor_t *A_;
+    uint32_t rank_;
+    uint32_t size_;
+    uint64_t membership_version_;
+    uint32_t sequence_;
+    size_t outstanding_;
+    int64_t deadline_ns_;
+    std::map<std::pair<uint32_t,uint64_t>, comms_packet_t> unexpected_;
+    std::vector<comms_packet_t> send_list_;
+    std::string error_;
+
+    comms_collective_t(comms_t *C, comms_accessor_t *A);
+    ~comms_collective_t();
+
+    void begin();
+    bool end(bool ok);
+    uint64_t tag(uint32_t step, uint32_t chunk) const;
+    bool progress();
+    void send(uint32_t dst, uint32_t step, const uint8_t *data, size_t size);
+    bool receive(uint32_t src, uint32_t step, size_t size, const consumer_t& consume);
+    bool receive_into(uint32_t src, uint32_t step, uint8_t *data, size_t size);
+    bool wait_sent();
+
+    bool broadcast(uint8_t *data, size_t size, uint32_t root, uint32_t step);
+    bool gather(const uint8_t *send, size_t size, uint8_t *recv, uint32_t root);
+    bool scatter(const uint8_t *send, size_t size, uint8_t *recv, uint32_t root);
+    bool allreduce_tree(uint8_t *data, size_t count, size_t element_size, comms_reduce_fn_t reduce);
+    bool allreduce_ring(uint8_t *data, size_t count, size_t element_size, comms_reduce_fn_t reduce);
+} comms_collective_t;
+
 #endif // __COMMS_IMPL_H_
@@ -0,0 +1,75 @@
+#include <algorithm>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+comms_match_bucket_t::comms_match_bucket_t()
+        : size_(0) {
+}
+
+comms_matcher_t::comms_matcher_t()
+        : size_(0) {
+}
+
+// Fibonacci hashing; tags are often sequential or differ only in high bits.
+size_t comms_matcher_t::bucket(uint64_t tag) {
+    return (tag * 0x9e3779b97f4a7c15ull) >> 58;
+}
+
+void comms_matcher_t::put(const comms_packet_t packet_list[],
+                          size_t packet_count) {
+    static_assert(COMMS_MATCH_BUCKETS == 64, "bucket() yields six bits");
+    for (size_t index=0; index<packet_count; index++) {
+        comms_match_bucket_t& bucket = buckets_[comms_matcher_t::bucket(packet_list[index].caught.opaque)];
+        std::lock_guard<std::mutex> lck(bucket.mtx_);
+        bucket.packets_.push_back(packet_list[index]);
+        bucket.size_.store(bucket.packets_.size(), std::memory_order_release);
+    }
+    size_.fetch_add(packet_count, std::memory_order_release);
+}
+
+// Moves matching packets out in bucket order, keeping the rest in place.
+static size_t comms_match_bucket_take(comms_match_bucket_t& bucket,
+                                      uint64_t tag,
+                                      uint64_t mask,
+                                      comms_packet_t packet_list[],
+                                      size_t packet_count) {
+    if (bucket.size_.load(std::memory_order_acquire) == 0) return 0;
+
+    std::lock_guard<std::mutex> lck(bucket.mtx_);
+    std::vector<comms_packet_t>& packets = bucket.packets_;
+    size_t num_taken = 0;
+    size_t num_kept = 0;
+    for (size_t index=0; index<packets.size(); index++) {
+        if (num_taken < packet_count and (packets[index].caught.opaque & mask) == (tag & mask)) {
+            packet_list[num_taken++] = packets[index];
+        }
+        else {
+            packets[num_kept++] = packets[index];
+        }
+    }
+    packets.resize(num_kept);
+    bucket.size_.store(num_kept, std::memory_order_release);
+    return num_taken;
+}
+
+size_t comms_matcher_t::take(uint64_t tag,
+                             uint64_t mask,
+                             comms_packet_t packet_list[],
+                             size_t packet_count) {
+    if (packet_count == 0 or size_.load(std::memory_order_acquire) == 0) return 0;
+
+    size_t num_taken = 0;
+    if (mask == ~uint64_t(0)) {
+        num_taken = comms_match_bucket_take(buckets_[bucket(tag)], tag, mask, packet_list, packet_count);
+    }
+    else {
+        for (size_t index=0; index<COMMS_MATCH_BUCKETS and num_taken<packet_count; index++) {
+            num_taken += comms_match_bucket_take(buckets_[index], tag, mask, packet_list+num_taken, packet_count-num_taken);
+        }
+    }
+    size_.fetch_sub(num_taken, std::memory_order_release);
+    return num_taken;
+}
@@ -0,0 +1,334 @@
+#include <sstream>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+#define COMMS_METRICS_REQUEST_SIZE (8192)
+#define COMMS_METRICS_POLL_INTERVAL (100)
+
+// Cumulative histogram buckets are reported at every other power of two
+// microseconds, from 1us to about 16.8s.
+#define COMMS_METRICS_BUCKET_STEP (2)
+#define COMMS_METRICS_BUCKET_MAX  (24)
+
+comms_metrics_t::comms_metrics_t(comms_t *C)
+        : C_(C)
+        , shutting_down_(false)
+        , thread_(nullptr) {
+}
+
+static int comms_metrics_listen_tcp(uint16_t port) {
+    int fd = socket(AF_INET6, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in6 addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(port);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 or listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int comms_metrics_listen_unix(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path)-1);
+
+    // A stale socket from a previous run would make bind fail.
+    unlink(path);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 or listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool comms_metrics_t::start(uint16_t port,
+                            const char *socket_path) {
+    if (port != 0) {
+        int fd = comms_metrics_listen_tcp(port);
+        if (fd < 0) return false;
+        listeners_.push_back(fd);
+    }
+
+    if (socket_path != NULL) {
+        int fd = comms_metrics_listen_unix(socket_path);
+        if (fd < 0) {
+            shutdown();
+            return false;
+        }
+        listeners_.push_back(fd);
+        socket_path_ = socket_path;
+    }
+
+    thread_ = std::make_shared<std::thread>(&comms_metrics_t::run, this);
+    return true;
+}
+
+void comms_metrics_t::run() {
+    std::vector<struct pollfd> fds(listeners_.size());
+    for (size_t index=0; index<listeners_.size(); index++) {
+        fds[index].fd = listeners_[index];
+        fds[index].events = POLLIN;
+    }
+
+    while (not shutting_down_) {
+        int ready = poll(fds.data(), fds.size(), COMMS_METRICS_POLL_INTERVAL);
+        if (ready <= 0) continue;
+
+        for (auto& pfd : fds) {
+            if (not (pfd.revents & POLLIN)) continue;
+            int fd = accept(pfd.fd, NULL, NULL);
+            if (fd < 0) continue;
+            serve(fd);
+            close(fd);
+        }
+    }
+}
+
+static void comms_metrics_write(int fd,
+                                const std::string& str) {
+    size_t offset = 0;
+    while (offset < str.size()) {
+        ssize_t written = send(fd, str.data()+offset, str.size()-offset, MSG_NOSIGNAL);
+        if (written <= 0) return;
+        offset += written;
+    }
+}
+
+void comms_metrics_t::serve(int fd) {
+    // Don't let a stalled client hold up the next scrape.
+    struct timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos and request.size() < COMMS_METRICS_REQUEST_SIZE) {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) return;
+        request.append(buffer, received);
+    }
+
+    std::string body;
+    const char *status = "200 OK";
+    if (request.compare(0, 13, "GET /metrics ") == 0 or request.compare(0, 6, "GET / ") == 0) {
+        body = text();
+    }
+    else {
+        status = "404 Not Found";
+        body = "Not found. Metrics are served at /metrics.\n";
+    }
+
+    std::stringstream ss;
+    ss << "HTTP/1.1 " << status << "\r\n"
+       << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+       << "Content-Length: " << body.size() << "\r\n"
+       << "Connection: close\r\n\r\n"
+       << body;
+    comms_metrics_write(fd, ss.str());
+}
+
+void comms_metrics_t::add_source(comms_metrics_source_t source,
+                                 void *context) {
+    std::unique_lock<std::mutex> lck(sources_mtx_);
+    sources_.push_back({source, context});
+}
+
+std::string comms_metrics_t::text() {
+    std::string str = C_->metrics_text();
+
+    std::unique_lock<std::mutex> lck(sources_mtx_);
+    for (auto& entry : sources_) {
+        char *text = NULL;
+        char *error = NULL;
+        if (entry.source_(entry.context_, &text, &error) == 0 and text != NULL) {
+            str += text;
+        }
+        free(text);
+        free(error);
+    }
+    return str;
+}
+
+void comms_metrics_t::shutdown() {
+    shutting_down_ = true;
+    if (thread_) {
+        thread_->join();
+        thread_ = nullptr;
+    }
+
+    for (int fd : listeners_) {
+        close(fd);
+    }
+    listeners_.clear();
+
+    if (not socket_path_.empty()) {
+        unlink(socket_path_.c_str());
+        socket_path_.clear();
+    }
+}
+
+// Label values escape backslash, double quote and newline.
+static std::string comms_metrics_label(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+        case '\\': escaped += "\\\\"; break;
+        case '"':  escaped += "\\\""; break;
+        case '\n': escaped += "\\n"; break;
+        default:   escaped += c;
+        }
+    }
+    return escaped;
+}
+
+static void comms_metrics_header(std::stringstream& ss,
+                                 const std::string& name,
+                                 const char *type,
+                                 const char *help) {
+    ss << "# HELP " << name << " " << help << "\n"
+       << "# TYPE " << name << " " << type << "\n";
+}
+
+static void comms_metrics_histogram(std::stringstream& ss,
+                                    const char *name,
+                                    const char *help,
+                                    const std::vector<uint64_t>& buckets,
+                                    uint64_t sum_us) {
+    comms_metrics_header(ss, name, "histogram", help);
+
+    uint64_t count = 0;
+    size_t index = 0;
+    for (size_t exponent=0; exponent<=COMMS_METRICS_BUCKET_MAX; exponent+=COMMS_METRICS_BUCKET_STEP) {
+        size_t end = comms_histogram_t::bucket(uint64_t(1) << exponent);
+        for (; index<end and index<buckets.size(); index++) {
+            count += buckets[index];
+        }
+        // The histogram counts whole microseconds below the bound.
+        ss << name << "_bucket{le=\"" << ((uint64_t(1) << exponent) - 1) / 1e6 << "\"} " << count << "\n";
+    }
+    for (; index<buckets.size(); index++) {
+        count += buckets[index];
+    }
+    ss << name << "_bucket{le=\"+Inf\"} " << count << "\n"
+       << name << "_sum " << sum_us / 1e6 << "\n"
+       << name << "_count " << count << "\n";
+}
+
+std::string comms_t::metrics_text() {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(6);
+    comms_stats_t totals;
+    stats(-1, -1, &totals);
+
+    std::vector<uint64_t> transmit_buckets(COMMS_HISTOGRAM_BUCKETS, 0);
+    std::vector<uint64_t> reap_buckets(COMMS_HISTOGRAM_BUCKETS, 0);
+    uint64_t transmit_max = 0;
+    uint64_t reap_max = 0;
+    uint64_t transmit_sum = 0;
+    uint64_t reap_sum = 0;
+
+    std::unique_lock<std::mutex> lck(stats_mtx_);
+    for (int counter=0; counter<COMMS_COUNTER_COUNT; counter++) {
+        std::string name = std::string("comms_") + comms_counter_names[counter] + "_total";
+        comms_metrics_header(ss, name, "counter", "Per end point and lane.");
+        for (size_t end_point=0; end_point<end_points().size(); end_point++) {
+            for (int lane=0; lane<lane_count_; lane++) {
+                uint64_t value = 0;
+                for (auto& shard : stats_shards_) {
+                    value += shard->get(end_point, lane, counter);
+                }
+                ss << name << "{end_point=\"" << comms_metrics_label(end_points()[end_point]->name())
+                   << "\",lane=\"" << lane << "\"} " << value << "\n";
+            }
+        }
+    }
+
+    for (auto& shard : stats_shards_) {
+        shard->transmit_latency_.merge_into(transmit_buckets, transmit_max);
+        shard->reap_latency_.merge_into(reap_buckets, reap_max);
+        transmit_sum += shard->transmit_latency_.sum();
+        reap_sum += shard->reap_latency_.sum();
+    }
+    lck.unlock();
+
+    comms_metrics_header(ss, "comms_submit_queue_depth", "gauge", "Bundles waiting for a writer.");
+    ss << "comms_submit_queue_depth " << totals.submit_queue_depth << "\n";
+    comms_metrics_header(ss, "comms_catch_queue_depth", "gauge", "Received bundles waiting to be caught.");
+    ss << "comms_catch_queue_depth " << totals.catch_queue_depth << "\n";
+    comms_metrics_header(ss, "comms_reap_queue_depth", "gauge", "Packets waiting to be reaped.");
+    ss << "comms_reap_queue_depth " << totals.reap_queue_depth << "\n";
+
+    comms_metrics_header(ss, "comms_end_point_breaker_state", "gauge", "Circuit breaker state: 0 closed, 1 open, 2 half open.");
+    for (auto& end_point : end_points()) {
+        comms_end_point_health_t health;
+        end_point->health(&health);
+        ss << "comms_end_point_breaker_state{end_point=\"" << comms_metrics_label(end_point->name()) << "\"} " << health.state << "\n";
+    }
+    comms_metrics_header(ss, "comms_end_point_rpc_latency_seconds", "gauge", "Smoothed RPC latency to the end point.");
+    for (auto& end_point : end_points()) {
+        comms_end_point_health_t health;
+        end_point->health(&health);
+        ss << "comms_end_point_rpc_latency_seconds{end_point=\"" << comms_metrics_label(end_point->name()) << "\"} " << health.latency_us / 1e6 << "\n";
+    }
+
+    comms_metrics_histogram(ss, "comms_transmit_latency_seconds", "Time spent in the Send RPC per bundle.", transmit_buckets, transmit_sum);
+    comms_metrics_histogram(ss, "comms_reap_latency_seconds", "Time from submit to reap per packet.", reap_buckets, reap_sum);
+
+    return ss.str();
+}
+
+int comms_metrics_text(comms_t *C,
+                       char **text,
+                       char **error) {
+    std::string str = C->metrics_.text();
+    text[0] = (char*)calloc(str.size()+1, sizeof(char));
+    if (text[0] == NULL) {
+        std::stringstream ss;
+        ss << "Unable to allocate memory for metrics.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    memcpy(text[0], str.c_str(), str.size()+1);
+    return 0;
+}
+
+int comms_metrics_add_source(comms_t *C,
+                             comms_metrics_source_t source,
+                             void *context,
+                             char **error) {
+    if (source == NULL) {
+        std::stringstream ss;
+        ss << "Metrics source must not be NULL.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    C->metrics_.add_source(source, context);
+    return 0;
+}
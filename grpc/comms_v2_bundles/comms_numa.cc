@@ -0,0 +1,132 @@
+#include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#ifdef COMMS_USE_NUMA
+#include <numa.h>
+#include <numaif.h>
+#endif
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+// NUMA node queue memory is placed on, -1 for the default policy.
+static thread_local int comms_numa_preferred_node = -1;
+
+bool comms_parse_cpus(const char *value,
+                      cpu_set_t *cpus) {
+    CPU_ZERO(cpus);
+
+    // Comma separated CPUs and inclusive ranges, e.g. "0-3,8,10-11".
+    const char *cursor = value;
+    while (*cursor != '\0') {
+        char *end;
+        long first = strtol(cursor, &end, 10);
+        if (end == cursor or first < 0) return false;
+        long last = first;
+        cursor = end;
+
+        if (*cursor == '-') {
+            last = strtol(cursor+1, &end, 10);
+            if (end == cursor+1 or last < first) return false;
+            cursor = end;
+        }
+        if (last >= CPU_SETSIZE) return false;
+
+        for (long cpu=first; cpu<=last; cpu++) {
+            CPU_SET(cpu, cpus);
+        }
+
+        if (*cursor == ',') cursor++;
+        else if (*cursor != '\0') return false;
+    }
+    return true;
+}
+
+void comms_pin_thread(const cpu_set_t& cpus) {
+    if (CPU_COUNT(&cpus) == 0) return;
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus);
+}
+
+int comms_numa_node_of(const cpu_set_t& cpus) {
+#ifdef COMMS_USE_NUMA
+    if (numa_available() < 0) return -1;
+    for (int cpu=0; cpu<CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpus)) return numa_node_of_cpu(cpu);
+    }
+#endif
+    return -1;
+}
+
+int comms_numa_local_node() {
+#ifdef COMMS_USE_NUMA
+    if (numa_available() < 0) return -1;
+    int cpu = sched_getcpu();
+    return cpu < 0 ? -1 : numa_node_of_cpu(cpu);
+#else
+    return -1;
+#endif
+}
+
+comms_numa_scope_t::comms_numa_scope_t(int node)
+        : previous_(comms_numa_preferred_node) {
+    comms_numa_preferred_node = node;
+}
+
+comms_numa_scope_t::~comms_numa_scope_t() {
+    comms_numa_preferred_node = previous_;
+}
+
+#ifdef COMMS_USE_NUMA
+// Every allocation is headed by its mapping size, or zero when it came from
+// malloc. The header keeps the returned pointer max-aligned.
+#define COMMS_NUMA_HEADER_SIZE (alignof(std::max_align_t))
+
+void *comms_numa_malloc(size_t size) {
+    const int node = comms_numa_preferred_node;
+    if (node < 0 or node >= static_cast<int>(sizeof(unsigned long)*8)) {
+        uint8_t *raw = static_cast<uint8_t*>(malloc(size + COMMS_NUMA_HEADER_SIZE));
+        if (raw == nullptr) return nullptr;
+        *reinterpret_cast<size_t*>(raw) = 0;
+        return raw + COMMS_NUMA_HEADER_SIZE;
+    }
+
+    // Bind the pages before anything touches them so that they are faulted
+    // in on the preferred node.
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mapped = (size + COMMS_NUMA_HEADER_SIZE + page_size - 1) & ~(page_size - 1);
+    void *raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+
+    unsigned long mask = 1UL << node;
+    mbind(raw, mapped, MPOL_PREFERRED, &mask, sizeof(mask)*8, 0);
+
+    *static_cast<size_t*>(raw) = mapped;
+    return static_cast<uint8_t*>(raw) + COMMS_NUMA_HEADER_SIZE;
+}
+
+void comms_numa_free(void *ptr) {
+    if (ptr == nullptr) return;
+
+    uint8_t *raw = static_cast<uint8_t*>(ptr) - COMMS_NUMA_HEADER_SIZE;
+    size_t mapped = *reinterpret_cast<size_t*>(raw);
+    if (mapped == 0) {
+        free(raw);
+    }
+    else {
+        munmap(raw, mapped);
+    }
+}
+#else
+void *comms_numa_malloc(size_t size) {
+    return malloc(size);
+}
+
+void comms_numa_free(void *ptr) {
+    free(ptr);
+}
+#endif
@@ -0,0 +1,144 @@
+#include <immintrin.h>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+bool comms_extract_dst_scalar(const comms_packet_t packet_list[],
+                              size_t packet_count,
+                              uint32_t dst_list[]) {
+    if (packet_count == 0) return true;
+
+    const uint32_t first = packet_list[0].submit.dst;
+    uint32_t diff = 0;
+    for (size_t index=0; index<packet_count; index++) {
+        dst_list[index] = packet_list[index].submit.dst;
+        diff |= dst_list[index] ^ first;
+    }
+    return diff == 0;
+}
+
+// Packets are 32 bytes apart, so each gather picks dst out of eight
+// consecutive packets.
+__attribute__((target("avx2")))
+static bool comms_extract_dst_avx2(const comms_packet_t packet_list[],
+                                   size_t packet_count,
+                                   uint32_t dst_list[]) {
+    static_assert(sizeof(comms_packet_t) == 8*sizeof(int), "packets must be eight words apart");
+    if (packet_count == 0) return true;
+
+    const uint32_t first = packet_list[0].submit.dst;
+    const int *base = reinterpret_cast<const int*>(&packet_list[0].submit.dst);
+    const __m256i offsets = _mm256_setr_epi32(0, 8, 16, 24, 32, 40, 48, 56);
+    const __m256i firsts = _mm256_set1_epi32(static_cast<int>(first));
+    __m256i diffs = _mm256_setzero_si256();
+
+    size_t index = 0;
+    for (; index+8<=packet_count; index+=8) {
+        __m256i dsts = _mm256_i32gather_epi32(base + 8*index, offsets, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_list + index), dsts);
+        diffs = _mm256_or_si256(diffs, _mm256_xor_si256(dsts, firsts));
+    }
+
+    uint32_t diff = _mm256_testz_si256(diffs, diffs) ? 0 : 1;
+    for (; index<packet_count; index++) {
+        dst_list[index] = packet_list[index].submit.dst;
+        diff |= dst_list[index] ^ first;
+    }
+    return diff == 0;
+}
+
+typedef bool (*comms_extract_dst_fn_t)(const comms_packet_t[], size_t, uint32_t[]);
+
+static comms_extract_dst_fn_t comms_extract_dst_resolve() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return comms_extract_dst_avx2;
+    }
+    return comms_extract_dst_scalar;
+}
+
+bool comms_extract_dst(const comms_packet_t packet_list[],
+                       size_t packet_count,
+                       uint32_t dst_list[]) {
+    static const comms_extract_dst_fn_t extract = comms_extract_dst_resolve();
+    return extract(packet_list, packet_count, dst_list);
+}
+
+comms_partition_t::comms_partition_t(size_t end_point_count)
+        : count_list_(end_point_count, 0)
+        , uniform_(true)
+        , sparse_(false) {
+}
+
+void comms_partition_t::run(const comms_packet_t packet_list[],
+                            size_t packet_count) {
+    touched_.clear();
+    start_list_.clear();
+    if (dst_list_.size() < packet_count) {
+        dst_list_.resize(packet_count);
+        index_list_.resize(packet_count);
+    }
+
+    sparse_ = false;
+    uniform_ = comms_extract_dst(packet_list, packet_count, dst_list_.data());
+    if (packet_count == 0) return;
+    if (uniform_) {
+        touched_.push_back(dst_list_[0]);
+        start_list_.push_back(0);
+        start_list_.push_back(static_cast<uint32_t>(packet_count));
+        return;
+    }
+
+    // Histogram, remembering destinations in the order they first appear.
+    for (size_t index=0; index<packet_count; index++) {
+        uint32_t dst = dst_list_[index];
+        if (count_list_[dst]++ == 0) {
+            touched_.push_back(dst);
+        }
+    }
+
+    if (touched_.size()*COMMS_PARTITION_MIN_GROUP > packet_count) {
+        for (uint32_t dst : touched_) {
+            count_list_[dst] = 0;
+        }
+        touched_.clear();
+        sparse_ = true;
+        return;
+    }
+
+    // Turn the counts into start offsets.
+    uint32_t offset = 0;
+    for (uint32_t dst : touched_) {
+        start_list_.push_back(offset);
+        offset += count_list_[dst];
+        count_list_[dst] = start_list_.back();
+    }
+    start_list_.push_back(offset);
+
+    // Scatter the indices, then clear the counts for the next run.
+    for (size_t index=0; index<packet_count; index++) {
+        index_list_[count_list_[dst_list_[index]]++] = static_cast<uint32_t>(index);
+    }
+    for (uint32_t dst : touched_) {
+        count_list_[dst] = 0;
+    }
+}
+
+size_t comms_partition_t::group_count() const {
+    return touched_.size();
+}
+
+uint32_t comms_partition_t::group_dst(size_t group) const {
+    return touched_[group];
+}
+
+size_t comms_partition_t::group_size(size_t group) const {
+    return start_list_[group+1] - start_list_[group];
+}
+
+// Null for a uniform run; its group is the packet list itself.
+const uint32_t *comms_partition_t::group_index_list(size_t group) const {
+    return uniform_ ? nullptr : index_list_.data() + start_list_[group];
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+comms_payload_slab_t::comms_payload_slab_t(size_t block_size,
+                                           size_t block_count,
+                                           int size_class)
+        : base_(nullptr)
+        , block_size_(block_size)
+        , block_count_(block_count)
+        , size_class_(size_class)
+        , allocated_((block_count+63)/64, 0)
+        , recycle_((block_count+63)/64, 0) {
+    // Payloads are written and reaped by the accessor's thread.
+    comms_numa_scope_t scope(comms_numa_local_node());
+    base_ = static_cast<uint8_t*>(comms_numa_malloc(block_size*block_count));
+}
+
+comms_payload_slab_t::~comms_payload_slab_t() {
+    comms_numa_free(base_);
+}
+
+comms_payload_pool_t::comms_payload_pool_t()
+        : free_lists_(COMMS_PAYLOAD_MAX_SHIFT - COMMS_PAYLOAD_MIN_SHIFT + 1)
+        , recycle_count_(0) {
+}
+
+static int comms_payload_size_class(size_t size) {
+    int shift = size <= 1 ? 0 : 64 - __builtin_clzll(size-1);
+    return std::max(shift, COMMS_PAYLOAD_MIN_SHIFT) - COMMS_PAYLOAD_MIN_SHIFT;
+}
+
+uint8_t *comms_payload_pool_t::alloc(size_t size,
+                                     bool recycle) {
+    int size_class = comms_payload_size_class(size);
+    comms_payload_block_t block;
+
+    if (size_class >= static_cast<int>(free_lists_.size())) {
+        std::unique_ptr<comms_payload_slab_t> slab(new comms_payload_slab_t(size, 1, -1));
+        if (slab->base_ == nullptr) return nullptr;
+        block.slab_ = slab.get();
+        block.index_ = 0;
+        slabs_.emplace(reinterpret_cast<uintptr_t>(slab->base_), std::move(slab));
+    }
+    else {
+        std::vector<comms_payload_block_t>& free_list = free_lists_[size_class];
+        if (free_list.empty()) {
+            size_t block_size = size_t(1) << (size_class + COMMS_PAYLOAD_MIN_SHIFT);
+            size_t block_count = std::max(size_t(1), COMMS_PAYLOAD_SLAB_SIZE / block_size);
+            std::unique_ptr<comms_payload_slab_t> slab(new comms_payload_slab_t(block_size, block_count, size_class));
+            if (slab->base_ == nullptr) return nullptr;
+
+            // Lowest addresses are handed out first.
+            for (size_t index=block_count; index>0; index--) {
+                free_list.push_back({slab.get(), index-1});
+            }
+            slabs_.emplace(reinterpret_cast<uintptr_t>(slab->base_), std::move(slab));
+        }
+        block = free_list.back();
+        free_list.pop_back();
+    }
+
+    comms_payload_slab_t& slab = *block.slab_;
+    slab.allocated_[block.index_/64] |= uint64_t(1) << (block.index_%64);
+    if (recycle) {
+        slab.recycle_[block.index_/64] |= uint64_t(1) << (block.index_%64);
+        recycle_count_++;
+    }
+    return slab.base_ + block.index_*slab.block_size_;
+}
+
+// Finds the allocated block starting at payload, if there is one.
+bool comms_payload_pool_t::find(const uint8_t *payload,
+                                comms_payload_block_t *block) const {
+    uintptr_t address = reinterpret_cast<uintptr_t>(payload);
+    auto entry = slabs_.upper_bound(address);
+    if (entry == slabs_.begin()) return false;
+    --entry;
+
+    comms_payload_slab_t& slab = *entry->second;
+    size_t offset = address - entry->first;
+    if (offset >= slab.block_size_*slab.block_count_ or offset % slab.block_size_ != 0) return false;
+
+    size_t index = offset / slab.block_size_;
+    if (not ((slab.allocated_[index/64] >> (index%64)) & 1)) return false;
+    block->slab_ = &slab;
+    block->index_ = index;
+    return true;
+}
+
+bool comms_payload_pool_t::free(uint8_t *payload) {
+    comms_payload_block_t block;
+    if (not find(payload, &block)) return false;
+
+    comms_payload_slab_t& slab = *block.slab_;
+    uint64_t bit = uint64_t(1) << (block.index_%64);
+    if (slab.recycle_[block.index_/64] & bit) {
+        recycle_count_--;
+    }
+    slab.allocated_[block.index_/64] &= ~bit;
+    slab.recycle_[block.index_/64] &= ~bit;
+
+    if (slab.size_class_ < 0) {
+        slabs_.erase(reinterpret_cast<uintptr_t>(slab.base_));
+    }
+    else {
+        free_lists_[slab.size_class_].push_back(block);
+    }
+    return true;
+}
+
+// Costs nothing until a recycled payload has been handed out.
+void comms_payload_pool_t::recycle(comms_packet_t packet_list[],
+                                   size_t packet_count) {
+    if (recycle_count_ == 0) return;
+
+    for (size_t index=0; index<packet_count; index++) {
+        comms_payload_block_t block;
+        if (not find(packet_list[index].payload, &block)) continue;
+        if (not ((block.slab_->recycle_[block.index_/64] >> (block.index_%64)) & 1)) continue;
+        free(packet_list[index].payload);
+        packet_list[index].payload = nullptr;
+    }
+}
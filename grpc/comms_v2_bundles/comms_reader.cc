@@ -11,6 +11,7 @@ comms_reader_t::comms_reader_t(comms_t *C)
         , shutting_down_(false)
         , shutdown_(false)
         , thread_(nullptr)
+        , stats_(C->create_stats_shard())
 {}
 
 void comms_reader_t::start() {
@@ -18,16 +19,61 @@ void comms_reader_t::start() {
 }
 
 void comms_reader_t::run() {
+    comms_pin_thread(C_->conf_.reader_cpus);
+
     {
         std::unique_lock<std::mutex> lck(started_mtx_);
         started_ = true;
         started_cv_.notify_all();
     }
 
+    const size_t packet_count = 1024;
+    comms_packet_t packet_list[packet_count];
+
+#ifdef COMMS_USE_TOKENS
+    moodycamel::ConsumerToken release_token(*C_->release_queue_);
+#endif
+
     while (true) {
-        if (shutting_down_) break;
-        // TODO: Do something.
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        // Released packets drop their reference on the block holding their
+        // payload. Once a block is fully released, the sender gets its credit
+        // back.
+#ifdef COMMS_USE_TOKENS
+        size_t num_released = C_->release_queue_->try_dequeue_bulk(release_token, packet_list, packet_count);
+#else
+        size_t num_released = C_->release_queue_->try_dequeue_bulk(packet_list, packet_count);
+#endif
+        if (num_released == 0) {
+            if (shutting_down_) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        // Packets from one block tend to be released together, so count runs
+        // and drop the references in one go.
+        size_t index = 0;
+        while (index < num_released) {
+            comms_catch_block_t *block = comms_catch_block_t::from_payload(packet_list[index].payload);
+            size_t run = 1;
+            while (index+run < num_released and comms_catch_block_t::from_payload(packet_list[index+run].payload) == block) {
+                run++;
+            }
+
+            stats_->add(block->src_, block->lane_, COMMS_COUNTER_RELEASED_PACKETS, run);
+            if (block->traced_) {
+                for (size_t offset=0; offset<run; offset++) {
+                    uint64_t tag = packet_list[index+offset].caught.opaque;
+                    if (C_->tracer_.sampled(tag)) {
+                        C_->tracer_.stamp(tag, block->lane_, COMMS_TRACE_RELEASE);
+                    }
+                }
+            }
+            if (block->unref(run)) {
+                C_->end_points()[block->src_]->release(block->lane_);
+                block->destroy();
+            }
+            index += run;
+        }
     }
 
     // Acquire shutdown mutex and notify shutdown.
@@ -4,11 +4,18 @@ extern "C" {
 }
 #include "comms_impl.h"
 
-comms_receiver_t::comms_receiver_t(std::vector<std::shared_ptr<comms_reader_t>>& readers)
-        : started_(false)
+comms_receiver_t::comms_receiver_t(comms_t *C,
+                                   std::vector<std::shared_ptr<comms_reader_t>>& readers)
+        : C_(C)
+        , started_(false)
         , shutting_down_(false)
         , shutdown_(false)
         , readers_(readers)
+#ifdef COMMS_USE_TOKENS
+        , catch_token_(nullptr)
+#endif
+        , reorder_(C)
+        , dedup_(C)
 {}
 
 void comms_receiver_t::start(std::string address) {
@@ -16,11 +23,20 @@ void comms_receiver_t::start(std::string address) {
 }
 
 void comms_receiver_t::run(std::string address) {
+    comms_pin_thread(C_->conf_.receiver_cpus);
+
     for (auto reader : readers_) {
         reader->wait_for_start();
     }
 
+#ifdef COMMS_USE_TOKENS
+    // Only this thread enqueues caught bundles.
+    moodycamel::ProducerToken catch_token(*C_->catch_queue_);
+    catch_token_ = &catch_token;
+#endif
+
     ::grpc::ServerBuilder builder;
+    C_->conf_.apply(builder, C_->resource_quota_.get());
     builder.AddListeningPort(address, ::grpc::InsecureServerCredentials());
     builder.RegisterService(&service_);
 #ifdef COMMS_USE_ASYNC_SERVICE
@@ -39,11 +55,21 @@ void comms_receiver_t::run(std::string address) {
     }
 
 #ifdef COMMS_USE_ASYNC_SERVICE
-    new CallData(&service_, cq_.get());
+    new CallData(C_, &service_, cq_.get());
     void *tag;
     bool ok;
     while (true) {
-        bool got_event = cq_->Next(&tag, &ok);
+        bool got_event;
+        if (C_->conf_.ordered_lanes == 0) {
+            got_event = cq_->Next(&tag, &ok);
+        }
+        else {
+            // Wake up now and then to skip reorder gaps that timed out.
+            auto status = cq_->AsyncNext(&tag, &ok, std::chrono::system_clock::now() + std::chrono::milliseconds(COMMS_REORDER_TICK_MS));
+            reorder_.expire();
+            if (status == ::grpc::CompletionQueue::TIMEOUT) continue;
+            got_event = status == ::grpc::CompletionQueue::GOT_EVENT;
+        }
 
         // If `got_event` is false, the queue is fully drained and shut down.
         if (not got_event) {
@@ -66,12 +92,28 @@ void comms_receiver_t::run(std::string address) {
 #endif
 
 shutdown:
+#ifdef COMMS_USE_TOKENS
+    catch_token_ = nullptr;
+#endif
+
     // Acquire shutdown lock and notify shutdown.
     std::unique_lock<std::mutex> lck(shutdown_mtx_);
     shutdown_ = true;
     shutdown_cv_.notify_all();
 }
 
+// Exclusive lanes have a catch queue of their own; the receiver's token only
+// covers the shared one.
+bool comms_receiver_t::deposit(comms_bundle_t& bundle) {
+    BundleQueue *catch_queue = C_->catch_queue(bundle.lane());
+#ifdef COMMS_USE_TOKENS
+    if (catch_queue == C_->catch_queue_.get()) {
+        return catch_queue->try_enqueue(*catch_token_, bundle);
+    }
+#endif
+    return catch_queue->try_enqueue(bundle);
+}
+
 void comms_receiver_t::wait_for_start() {
     if (shutdown_) return;
     if (shutting_down_) return;
@@ -103,9 +145,18 @@ void comms_receiver_t::wait_for_shutdown() {
 }
 
 #ifdef COMMS_USE_ASYNC_SERVICE
-comms_receiver_t::CallData::CallData(::comms::Comms::AsyncService *service,
+// Compressed bundles may not inflate to more than the server would accept
+// uncompressed.
+static uint64_t comms_receiver_max_payloads_size(const config_t& conf) {
+    if (conf.max_receive_message_size < 0) return GRPC_DEFAULT_MAX_RECV_MESSAGE_LENGTH;
+    return static_cast<uint64_t>(conf.max_receive_message_size);
+}
+
+comms_receiver_t::CallData::CallData(comms_t *C,
+                                     ::comms::Comms::AsyncService *service,
                                      ::grpc::ServerCompletionQueue *cq)
-        : service_(service)
+        : C_(C)
+        , service_(service)
         , cq_(cq)
         , responder_(&ctx_)
         , status_(CREATE) {
@@ -122,9 +173,115 @@ void comms_receiver_t::CallData::Proceed() {
         service_->RequestSend(&ctx_, request_, &responder_, cq_, cq_, this);
     }
     else if (status_ == PROCESS) {
-        new CallData(service_, cq_);
-        // TODO: Forward incoming request to a reader.
+        new CallData(C_, service_, cq_);
         status_ = FINISH;
+
+        uint32_t src = static_cast<uint32_t>(request_->src());
+        uint32_t lane = static_cast<uint32_t>(request_->lane());
+        // A peer may learn of a new member before this process does, so a
+        // source within capacity is pushed back like a full queue: the
+        // sender retries without holding it against this process.
+        const std::vector<std::shared_ptr<EndPoint>>& end_points = C_->end_points();
+        if (src >= end_points.size() and src < C_->conf_.end_point_capacity) {
+            responder_.Finish(response_, ::grpc::Status(::grpc::StatusCode::RESOURCE_EXHAUSTED, "Source is not a member yet."), this);
+            return;
+        }
+        if (src >= end_points.size() or lane >= static_cast<uint32_t>(C_->lane_count_)
+                or request_->packet_size() > COMMS_BUNDLE_SIZE) {
+            responder_.Finish(response_, ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "Invalid source, lane or bundle size."), this);
+            return;
+        }
+        EndPoint& end_point = *end_points[src];
+        if (end_point.removed()) {
+            responder_.Finish(response_, ::grpc::Status(::grpc::StatusCode::PERMISSION_DENIED, "Source was removed from the membership."), this);
+            return;
+        }
+
+        // A retry of a bundle that was delivered is answered as a duplicate
+        // and goes no further.
+        uint64_t bundle_id = request_->bundle_id();
+        if (bundle_id != 0 and request_->packet_size() > 0) {
+            int seen = C_->receiver_->dedup_.check(src, request_->epoch(), bundle_id);
+            if (seen == COMMS_DEDUP_STALE) {
+                responder_.Finish(response_, ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "Bundle id is older than the dedup window."), this);
+                return;
+            }
+            response_.set_duplicate(seen == COMMS_DEDUP_DUPLICATE);
+        }
+
+        // Forward the packets to the catch queue. Empty bundles are credit
+        // polls, which only need the response, or skips.
+        if (request_->packet_size() > 0 and not response_.duplicate()) {
+            // Compressed payloads are inflated here and copied into the
+            // catch block from there. The claimed size is checked against the
+            // packets and the limit before anything is allocated, and a
+            // buffer grown past COMMS_RECEIVER_PAYLOADS_KEEP is let go again.
+            thread_local std::string payloads;
+            if (request_->codec() != COMMS_CODEC_NONE) {
+                uint64_t payloads_size = 0;
+                for (const ::comms::Packet& packet : request_->packet()) {
+                    payloads_size += packet.size();
+                }
+                bool ok = comms_codec_available(request_->codec()) and payloads_size == request_->block_size()
+                    and payloads_size <= comms_receiver_max_payloads_size(C_->conf_);
+                if (ok) {
+                    payloads.resize(payloads_size);
+                    ok = comms_codec_decompress(request_->codec(),
+                                                reinterpret_cast<const uint8_t*>(request_->block().data()), request_->block().size(),
+                                                reinterpret_cast<uint8_t*>(&payloads[0]), payloads.size());
+                }
+                if (not ok) {
+                    if (payloads.capacity() > COMMS_RECEIVER_PAYLOADS_KEEP) {
+                        std::string().swap(payloads);
+                    }
+                    responder_.Finish(response_, ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "Invalid or unsupported compressed bundle."), this);
+                    return;
+                }
+            }
+
+            comms_bundle_t bundle;
+            const uint8_t *block_payloads = request_->codec() != COMMS_CODEC_NONE ? reinterpret_cast<const uint8_t*>(payloads.data()) : nullptr;
+            comms_catch_block_t *block = comms_catch_block_t::create(*request_, block_payloads, bundle, C_->release_queue_.get());
+            if (payloads.capacity() > COMMS_RECEIVER_PAYLOADS_KEEP) {
+                std::string().swap(payloads);
+            }
+            if (block != nullptr and request_->trace_size() > 0) {
+                for (uint32_t index : request_->trace()) {
+                    if (index < bundle.size()) bundle.trace(index);
+                }
+                block->traced_ = true;
+                C_->tracer_.stamp(bundle, COMMS_TRACE_RECEIVER_ARRIVAL);
+            }
+            // Bundles on ordered lanes may have to wait for earlier ones.
+            int rc = COMMS_REORDER_FULL;
+            if (block != nullptr) {
+                rc = request_->sequence() != 0 and C_->ordered_lane(lane)
+                   ? C_->receiver_->reorder_.arrive(src, lane, request_->sequence(), &bundle)
+                   : (C_->receiver_->deposit(bundle) ? COMMS_REORDER_ACCEPTED : COMMS_REORDER_FULL);
+            }
+            if (rc != COMMS_REORDER_ACCEPTED and block != nullptr) {
+                block->destroy();
+            }
+            if (rc == COMMS_REORDER_FULL) {
+                responder_.Finish(response_, ::grpc::Status(::grpc::StatusCode::RESOURCE_EXHAUSTED, "Catch queue or reorder window is full."), this);
+                return;
+            }
+            if (rc == COMMS_REORDER_DUPLICATE) {
+                response_.set_duplicate(true);
+            }
+            else if (bundle_id != 0) {
+                C_->receiver_->dedup_.mark(src, request_->epoch(), bundle_id);
+            }
+        }
+        // An empty bundle with a sequence number is a skip.
+        else if (request_->packet_size() == 0 and request_->sequence() != 0 and C_->ordered_lane(lane)) {
+            if (C_->receiver_->reorder_.arrive(src, lane, request_->sequence(), nullptr) == COMMS_REORDER_FULL) {
+                responder_.Finish(response_, ::grpc::Status(::grpc::StatusCode::RESOURCE_EXHAUSTED, "Reorder window is full."), this);
+                return;
+            }
+        }
+
+        response_.set_credit_limit(end_point.credit_limit(lane));
         responder_.Finish(response_, ::grpc::Status::OK, this);
     }
     else {
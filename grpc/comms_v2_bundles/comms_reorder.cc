@@ -0,0 +1,134 @@
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+comms_reorder_stream_t::comms_reorder_stream_t()
+        : next_(0)
+        , stalled_at_(0) {
+}
+
+comms_reorder_t::comms_reorder_t(comms_t *C)
+        : C_(C)
+        , lane_count_(C->lane_count_)
+        , window_(C->conf_.reorder_window)
+        , timeout_ns_(static_cast<int64_t>(C->conf_.reorder_timeout)*1000000)
+        , pending_count_(0)
+        , streams_(C->conf_.ordered_lanes != 0 ? C->conf_.end_point_capacity*C->lane_count_ : 0) {
+}
+
+// Waiting bundles were never caught, so their catch blocks go with them.
+comms_reorder_t::~comms_reorder_t() {
+    for (auto& stream : streams_) {
+        for (auto& entry : stream.pending_) {
+            if (entry.second == nullptr) continue;
+            comms_catch_block_t::from_payload(entry.second->payload_list_[0])->destroy();
+            C_->bundle_pool_.release(entry.second);
+        }
+    }
+}
+
+// Hands waiting bundles on for as long as they follow on from next_. Skips
+// wait in pending_ as null bundles and only move next_ along.
+void comms_reorder_t::drain(comms_reorder_stream_t& stream) {
+    bool advanced = false;
+    while (not stream.pending_.empty() and stream.pending_.begin()->first == stream.next_) {
+        comms_bundle_t *bundle = stream.pending_.begin()->second;
+        if (bundle != nullptr) {
+            if (not C_->receiver_->deposit(*bundle)) break;
+            C_->bundle_pool_.release(bundle);
+        }
+        stream.pending_.erase(stream.pending_.begin());
+        pending_count_--;
+        stream.next_++;
+        advanced = true;
+    }
+    if (advanced) {
+        stream.stalled_at_ = comms_now_ns();
+    }
+}
+
+int comms_reorder_t::arrive(uint32_t src,
+                            uint32_t lane,
+                            uint64_t sequence,
+                            comms_bundle_t *bundle) {
+    comms_reorder_stream_t& stream = streams_[src*lane_count_ + lane];
+
+    // A stream starts wherever the sender is when we first hear from it, so
+    // either side may restart first. A sender that is still within its
+    // first window is taken to have started at 1, since its first bundles
+    // may overtake each other.
+    if (stream.next_ == 0) {
+        stream.next_ = sequence <= window_ ? 1 : sequence;
+    }
+
+    // A skip for a gap already closed has nothing left to do, however far
+    // behind it is.
+    if (bundle == nullptr and sequence < stream.next_) {
+        return COMMS_REORDER_ACCEPTED;
+    }
+
+    // Far behind: the sender has restarted and numbers from 1 again. What
+    // is waiting goes out first.
+    if (sequence + window_ < stream.next_) {
+        while (not stream.pending_.empty()) {
+            stream.next_ = stream.pending_.begin()->first;
+            drain(stream);
+            if (not stream.pending_.empty() and stream.pending_.begin()->first == stream.next_) {
+                return COMMS_REORDER_FULL;
+            }
+        }
+        stream.next_ = sequence;
+    }
+
+    // Late, after its gap was skipped.
+    if (sequence < stream.next_) {
+        return C_->receiver_->deposit(*bundle) ? COMMS_REORDER_ACCEPTED : COMMS_REORDER_FULL;
+    }
+
+    // The gap timer runs from the last time next_ moved.
+    if (sequence == stream.next_) {
+        if (bundle != nullptr and not C_->receiver_->deposit(*bundle)) return COMMS_REORDER_FULL;
+        stream.next_++;
+        stream.stalled_at_ = comms_now_ns();
+        drain(stream);
+        return COMMS_REORDER_ACCEPTED;
+    }
+
+    if (sequence >= stream.next_ + window_) return COMMS_REORDER_FULL;
+
+    // A bundle that turns up after all takes the place of its skip.
+    auto entry = stream.pending_.find(sequence);
+    if (entry != stream.pending_.end()) {
+        if (bundle == nullptr or entry->second != nullptr) return COMMS_REORDER_DUPLICATE;
+        entry->second = C_->bundle_pool_.acquire();
+        *entry->second = *bundle;
+        return COMMS_REORDER_ACCEPTED;
+    }
+
+    comms_bundle_t *copy = nullptr;
+    if (bundle != nullptr) {
+        copy = C_->bundle_pool_.acquire();
+        *copy = *bundle;
+    }
+    if (stream.pending_.empty()) {
+        stream.stalled_at_ = comms_now_ns();
+    }
+    stream.pending_.emplace(sequence, copy);
+    pending_count_++;
+    return COMMS_REORDER_ACCEPTED;
+}
+
+// Retries streams held up by a full catch queue and skips the gaps that
+// have been open longer than the timeout.
+void comms_reorder_t::expire() {
+    if (pending_count_ == 0) return;
+
+    int64_t now = comms_now_ns();
+    for (auto& stream : streams_) {
+        if (stream.pending_.empty()) continue;
+        if (stream.pending_.begin()->first != stream.next_ and now - stream.stalled_at_ < timeout_ns_) continue;
+        stream.next_ = stream.pending_.begin()->first;
+        drain(stream);
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef __COMMS_RING_H_
+#define __COMMS_RING_H_
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+#define COMMS_CACHE_LINE (64)
+
+// Bounded single-producer single-consumer ring. Capacity is rounded up to a
+// power of two. The producer and consumer each keep a cached copy of the
+// other's index on their own cache line, so the shared indices are only
+// read when the cached view says the ring is full or empty.
+template <typename T>
+struct comms_ring_t {
+    char pad0_[COMMS_CACHE_LINE];
+
+    // Producer side.
+    std::atomic<size_t> tail_;
+    size_t cached_head_;
+    char pad1_[COMMS_CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    // Consumer side.
+    std::atomic<size_t> head_;
+    size_t cached_tail_;
+    char pad2_[COMMS_CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    explicit comms_ring_t(size_t capacity)
+            : tail_(0)
+            , cached_head_(0)
+            , head_(0)
+            , cached_tail_(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        slots_ = std::unique_ptr<T[]>(new T[size]);
+    }
+
+    size_t capacity() const {
+        return mask_ + 1;
+    }
+
+    size_t size_approx() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_relaxed);
+    }
+
+    // Producer.
+    bool push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == capacity()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == capacity()) return false;
+        }
+        slots_[tail & mask_] = item;
+        tail_.store(tail+1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer, pushes as many items as fit and returns how many did.
+    size_t push_n(const T *items, size_t count) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (capacity() - (tail - cached_head_) < count) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+        }
+        size_t room = capacity() - (tail - cached_head_);
+        if (count > room) count = room;
+        for (size_t index=0; index<count; index++) {
+            slots_[(tail+index) & mask_] = items[index];
+        }
+        tail_.store(tail+count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer, the oldest item or nullptr. The slot stays valid until pop().
+    T *front() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+
+    void pop() {
+        head_.store(head_.load(std::memory_order_relaxed)+1, std::memory_order_release);
+    }
+
+    // Consumer, copies out up to max items and returns how many.
+    size_t pop_n(T *items, size_t max) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (cached_tail_ - head < max) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        }
+        size_t count = cached_tail_ - head;
+        if (count > max) count = max;
+        for (size_t index=0; index<count; index++) {
+            items[index] = slots_[(head+index) & mask_];
+        }
+        head_.store(head+count, std::memory_order_release);
+        return count;
+    }
+};
+
+#endif // __COMMS_RING_H_
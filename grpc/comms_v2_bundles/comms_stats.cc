@@ -0,0 +1,338 @@
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+const char *comms_counter_names[COMMS_COUNTER_COUNT] = {
+    "submitted_packets",
+    "submitted_bytes",
+    "transmitted_packets",
+    "transmitted_bytes",
+    "retried_packets",
+    "failed_packets",
+    "caught_packets",
+    "released_packets",
+};
+
+int64_t comms_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+comms_histogram_t::comms_histogram_t()
+        : max_(0)
+        , sum_(0) {
+    for (size_t index=0; index<COMMS_HISTOGRAM_BUCKETS; index++) {
+        buckets_[index] = 0;
+    }
+}
+
+size_t comms_histogram_t::bucket(uint64_t value) {
+    if (value < COMMS_HISTOGRAM_SUB_BUCKETS) return value;
+
+    // The top three bits below the leading one pick the sub-bucket.
+    size_t exponent = 63 - __builtin_clzll(value);
+    size_t sub_bucket = (value >> (exponent - 3)) & (COMMS_HISTOGRAM_SUB_BUCKETS - 1);
+    return COMMS_HISTOGRAM_SUB_BUCKETS + (exponent - 3)*COMMS_HISTOGRAM_SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t comms_histogram_t::bucket_value(size_t bucket) {
+    if (bucket < COMMS_HISTOGRAM_SUB_BUCKETS) return bucket;
+
+    size_t exponent = (bucket - COMMS_HISTOGRAM_SUB_BUCKETS) / COMMS_HISTOGRAM_SUB_BUCKETS + 3;
+    size_t sub_bucket = (bucket - COMMS_HISTOGRAM_SUB_BUCKETS) % COMMS_HISTOGRAM_SUB_BUCKETS;
+    return static_cast<uint64_t>(COMMS_HISTOGRAM_SUB_BUCKETS + sub_bucket) << (exponent - 3);
+}
+
+void comms_histogram_t::record(uint64_t value,
+                               uint64_t count) {
+    std::atomic<uint64_t>& slot = buckets_[bucket(value)];
+    slot.store(slot.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value*count, std::memory_order_relaxed);
+    if (value > max_.load(std::memory_order_relaxed)) {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+void comms_histogram_t::merge_into(std::vector<uint64_t>& buckets,
+                                   uint64_t& max) const {
+    buckets.resize(COMMS_HISTOGRAM_BUCKETS, 0);
+    for (size_t index=0; index<COMMS_HISTOGRAM_BUCKETS; index++) {
+        buckets[index] += buckets_[index].load(std::memory_order_relaxed);
+    }
+    max = std::max(max, max_.load(std::memory_order_relaxed));
+}
+
+uint64_t comms_histogram_t::sum() const {
+    return sum_.load(std::memory_order_relaxed);
+}
+
+uint64_t comms_histogram_t::percentile(const std::vector<uint64_t>& buckets,
+                                       double fraction) {
+    uint64_t total = 0;
+    for (uint64_t count : buckets) total += count;
+    if (total == 0) return 0;
+
+    uint64_t rank = static_cast<uint64_t>(fraction * total);
+    uint64_t seen = 0;
+    for (size_t index=0; index<buckets.size(); index++) {
+        seen += buckets[index];
+        if (seen > rank) return bucket_value(index);
+    }
+    return bucket_value(buckets.size()-1);
+}
+
+comms_stats_shard_t::comms_stats_shard_t(size_t end_point_count,
+                                         int lane_count)
+        : end_point_count_(end_point_count)
+        , lane_count_(lane_count)
+        , counters_(new std::atomic<uint64_t>[end_point_count*lane_count*COMMS_COUNTER_COUNT]) {
+    for (size_t index=0; index<end_point_count*lane_count*COMMS_COUNTER_COUNT; index++) {
+        counters_[index] = 0;
+    }
+}
+
+uint64_t comms_stats_shard_t::get(size_t end_point,
+                                  uint32_t lane,
+                                  int counter) const {
+    return counters_[(end_point*lane_count_ + lane)*COMMS_COUNTER_COUNT + counter].load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<comms_stats_shard_t> comms_t::create_stats_shard() {
+    std::unique_lock<std::mutex> lck(stats_mtx_);
+    if (not idle_stats_shards_.empty()) {
+        std::shared_ptr<comms_stats_shard_t> shard = idle_stats_shards_.back();
+        idle_stats_shards_.pop_back();
+        return shard;
+    }
+    lck.unlock();
+
+    auto shard = std::make_shared<comms_stats_shard_t>(conf_.end_point_capacity, lane_count_);
+
+    lck.lock();
+    stats_shards_.push_back(shard);
+    return shard;
+}
+
+void comms_t::attach(comms_accessor_t *A) {
+    std::unique_lock<std::mutex> lck(stats_mtx_);
+    accessors_.push_back(A);
+
+    // Hand the accessor's rings to the next writer in turn.
+    if (A->rings_) {
+        A->rings_->writer_ = next_ring_writer_++ % std::max<uint32_t>(conf_.writer_thread_count, 1);
+        rings_.push_back(A->rings_);
+        rings_version_++;
+    }
+}
+
+void comms_t::detach(comms_accessor_t *A) {
+    std::unique_lock<std::mutex> lck(stats_mtx_);
+    accessors_.erase(std::remove(accessors_.begin(), accessors_.end(), A), accessors_.end());
+    idle_stats_shards_.push_back(A->stats_);
+
+    if (A->rings_) {
+        rings_.erase(std::remove(rings_.begin(), rings_.end(), A->rings_), rings_.end());
+        rings_version_++;
+    }
+}
+
+void comms_t::stats(int end_point,
+                    int lane,
+                    comms_stats_t *stats) {
+    memset(stats, 0, sizeof(comms_stats_t));
+    uint64_t counters[COMMS_COUNTER_COUNT] = {0};
+
+    size_t end_point_begin = end_point < 0 ? 0 : end_point;
+    size_t end_point_end = end_point < 0 ? end_points().size() : end_point+1;
+    int lane_begin = lane < 0 ? 0 : lane;
+    int lane_end = lane < 0 ? lane_count_ : lane+1;
+
+    std::vector<uint64_t> transmit_buckets;
+    std::vector<uint64_t> reap_buckets;
+
+    std::unique_lock<std::mutex> lck(stats_mtx_);
+    for (auto& shard : stats_shards_) {
+        for (size_t end_point_id=end_point_begin; end_point_id<end_point_end; end_point_id++) {
+            for (int lane_id=lane_begin; lane_id<lane_end; lane_id++) {
+                for (int counter=0; counter<COMMS_COUNTER_COUNT; counter++) {
+                    counters[counter] += shard->get(end_point_id, lane_id, counter);
+                }
+            }
+        }
+        shard->transmit_latency_.merge_into(transmit_buckets, stats->transmit_latency_max_us);
+        shard->reap_latency_.merge_into(reap_buckets, stats->reap_latency_max_us);
+    }
+
+    for (auto *A : accessors_) {
+        stats->reap_queue_depth += A->reap_queue_->size_approx();
+        if (A->rings_) {
+            stats->submit_queue_depth += A->rings_->submit_.size_approx();
+            stats->reap_queue_depth += A->rings_->reap_.size_approx();
+        }
+    }
+
+    // Queue depths count bundles for the submit and catch queues and packets
+    // for the reap queues, rings included. The shared queues may be replaced
+    // at start, which holds the lock.
+    stats->submit_queue_depth += submit_queue_->size_approx();
+    stats->submit_queue_depth += priority_queue_->size_approx();
+    stats->catch_queue_depth = catch_queue_->size_approx();
+    for (auto& lane_catch_queue : lane_catch_queues_) {
+        stats->catch_queue_depth += lane_catch_queue ? lane_catch_queue->size_approx() : 0;
+    }
+    lck.unlock();
+
+    stats->submitted_packets = counters[COMMS_COUNTER_SUBMITTED_PACKETS];
+    stats->submitted_bytes = counters[COMMS_COUNTER_SUBMITTED_BYTES];
+    stats->transmitted_packets = counters[COMMS_COUNTER_TRANSMITTED_PACKETS];
+    stats->transmitted_bytes = counters[COMMS_COUNTER_TRANSMITTED_BYTES];
+    stats->retried_packets = counters[COMMS_COUNTER_RETRIED_PACKETS];
+    stats->failed_packets = counters[COMMS_COUNTER_FAILED_PACKETS];
+    stats->caught_packets = counters[COMMS_COUNTER_CAUGHT_PACKETS];
+    stats->released_packets = counters[COMMS_COUNTER_RELEASED_PACKETS];
+
+    stats->transmit_latency_p50_us = comms_histogram_t::percentile(transmit_buckets, 0.50);
+    stats->transmit_latency_p99_us = comms_histogram_t::percentile(transmit_buckets, 0.99);
+    stats->reap_latency_p50_us = comms_histogram_t::percentile(reap_buckets, 0.50);
+    stats->reap_latency_p99_us = comms_histogram_t::percentile(reap_buckets, 0.99);
+}
+
+static void comms_histogram_json(std::stringstream& ss,
+                                 const std::vector<uint64_t>& buckets,
+                                 uint64_t max) {
+    uint64_t count = 0;
+    for (uint64_t bucket_count : buckets) count += bucket_count;
+
+    ss << "{\"count\":" << count
+       << ",\"p50\":" << comms_histogram_t::percentile(buckets, 0.50)
+       << ",\"p90\":" << comms_histogram_t::percentile(buckets, 0.90)
+       << ",\"p99\":" << comms_histogram_t::percentile(buckets, 0.99)
+       << ",\"p999\":" << comms_histogram_t::percentile(buckets, 0.999)
+       << ",\"max\":" << max
+       << ",\"buckets\":[";
+    bool first = true;
+    for (size_t index=0; index<buckets.size(); index++) {
+        if (buckets[index] == 0) continue;
+        ss << (first ? "" : ",") << "[" << comms_histogram_t::bucket_value(index) << "," << buckets[index] << "]";
+        first = false;
+    }
+    ss << "]}";
+}
+
+// Escapes a string for a JSON string literal.
+static std::string comms_json_string(const std::string& value) {
+    std::stringstream ss;
+    for (char c : value) {
+        switch (c) {
+        case '"':  ss << "\\\""; break;
+        case '\\': ss << "\\\\"; break;
+        case '\n': ss << "\\n"; break;
+        case '\r': ss << "\\r"; break;
+        case '\t': ss << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+            }
+            else {
+                ss << c;
+            }
+        }
+    }
+    return ss.str();
+}
+
+std::string comms_t::stats_json() {
+    comms_stats_t totals;
+    stats(-1, -1, &totals);
+
+    std::vector<uint64_t> transmit_buckets(COMMS_HISTOGRAM_BUCKETS, 0);
+    std::vector<uint64_t> reap_buckets(COMMS_HISTOGRAM_BUCKETS, 0);
+    uint64_t transmit_max = 0;
+    uint64_t reap_max = 0;
+
+    std::stringstream ss;
+    ss << "{\"end_points\":[";
+
+    std::unique_lock<std::mutex> lck(stats_mtx_);
+    for (size_t end_point=0; end_point<end_points().size(); end_point++) {
+        ss << (end_point == 0 ? "" : ",")
+           << "{\"id\":" << end_point
+           << ",\"name\":\"" << comms_json_string(end_points()[end_point]->name()) << "\""
+           << ",\"lanes\":[";
+        for (int lane=0; lane<lane_count_; lane++) {
+            ss << (lane == 0 ? "" : ",") << "{\"lane\":" << lane;
+            for (int counter=0; counter<COMMS_COUNTER_COUNT; counter++) {
+                uint64_t value = 0;
+                for (auto& shard : stats_shards_) {
+                    value += shard->get(end_point, lane, counter);
+                }
+                ss << ",\"" << comms_counter_names[counter] << "\":" << value;
+            }
+            ss << "}";
+        }
+        ss << "]}";
+    }
+
+    for (auto& shard : stats_shards_) {
+        shard->transmit_latency_.merge_into(transmit_buckets, transmit_max);
+        shard->reap_latency_.merge_into(reap_buckets, reap_max);
+    }
+    lck.unlock();
+
+    ss << "],\"gauges\":{"
+       << "\"submit_queue_depth\":" << totals.submit_queue_depth
+       << ",\"catch_queue_depth\":" << totals.catch_queue_depth
+       << ",\"reap_queue_depth\":" << totals.reap_queue_depth
+       << "},\"histograms\":{\"transmit_latency_us\":";
+    comms_histogram_json(ss, transmit_buckets, transmit_max);
+    ss << ",\"reap_latency_us\":";
+    comms_histogram_json(ss, reap_buckets, reap_max);
+    ss << "}}";
+
+    return ss.str();
+}
+
+int comms_stats(comms_t *C,
+                int end_point,
+                int lane,
+                comms_stats_t *stats,
+                char **error) {
+    if (end_point >= static_cast<int>(C->end_points().size())) {
+        std::stringstream ss;
+        ss << "Invalid end point. Valid range: [0, " << C->end_points().size()
+           << ") or -1 for all; End point provided: " << end_point;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    if (lane >= C->lane_count_) {
+        std::stringstream ss;
+        ss << "Invalid lane number. Valid range: [0, " << C->lane_count_
+           << ") or -1 for all; Lane provided: " << lane;
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+
+    C->stats(end_point, lane, stats);
+    return 0;
+}
+
+int comms_stats_json(comms_t *C,
+                     char **json,
+                     char **error) {
+    std::string str = C->stats_json();
+    json[0] = (char*)calloc(str.size()+1, sizeof(char));
+    if (json[0] == NULL) {
+        std::stringstream ss;
+        ss << "Unable to allocate memory for stats.";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    memcpy(json[0], str.c_str(), str.size()+1);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <sstream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
+
+extern "C" {
+#include "comms.h"
+}
+#include "comms_impl.h"
+
+static const char *comms_trace_stage_names[COMMS_TRACE_STAGE_COUNT] = {
+    "submit",
+    "bundle_close",
+    "writer_dequeue",
+    "rpc_start",
+    "rpc_finish",
+    "receiver_arrival",
+    "catch",
+    "release",
+};
+
+// Tags are often sequential, so mix them before sampling to avoid picking
+// every n-th packet of the same stride.
+static uint64_t comms_trace_hash(uint64_t tag) {
+    tag ^= tag >> 33;
+    tag *= 0xff51afd7ed558ccdULL;
+    tag ^= tag >> 33;
+    tag *= 0xc4ceb9fe1a85ec53ULL;
+    tag ^= tag >> 33;
+    return tag;
+}
+
+comms_tracer_t::comms_tracer_t()
+        : sample_period_(0)
+        , origin_(comms_now_ns()) {
+}
+
+bool comms_tracer_t::sampled(uint64_t tag) const {
+    return sample_period_ != 0 and comms_trace_hash(tag) % sample_period_ == 0;
+}
+
+void comms_tracer_t::stamp(uint64_t tag,
+                           uint32_t lane,
+                           int stage) {
+    int64_t now = comms_now_ns();
+
+    std::unique_lock<std::mutex> lck(mtx_);
+    auto it = traces_.find(tag);
+    if (it == traces_.end()) {
+        // Only the first stage seen by this process starts a trace.
+        if (stage != COMMS_TRACE_SUBMIT and stage != COMMS_TRACE_RECEIVER_ARRIVAL) return;
+        if (traces_.size() >= COMMS_TRACE_CAPACITY) return;
+        it = traces_.emplace(tag, comms_trace_t()).first;
+        memset(it->second.stamps_, 0, sizeof(it->second.stamps_));
+    }
+    else if (stage == COMMS_TRACE_SUBMIT) {
+        // The tag was submitted again, start over.
+        memset(it->second.stamps_, 0, sizeof(it->second.stamps_));
+    }
+
+    it->second.lane_ = lane;
+    it->second.stamps_[stage] = now;
+}
+
+void comms_tracer_t::stamp(comms_bundle_t& bundle,
+                           int stage) {
+    for (uint32_t index=0; index<bundle.trace_count_; index++) {
+        stamp(bundle.tag_list_[bundle.trace_index_[index]], bundle.lane(), stage);
+    }
+}
+
+std::string comms_tracer_t::chrome_json(size_t pid) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    bool first = true;
+    std::unique_lock<std::mutex> lck(mtx_);
+    for (auto& entry : traces_) {
+        const comms_trace_t& trace = entry.second;
+
+        // Order the stages by time; on a loopback the receiver's stages
+        // interleave with the sender's.
+        std::vector<int> stages;
+        for (int stage=0; stage<COMMS_TRACE_STAGE_COUNT; stage++) {
+            if (trace.stamps_[stage] != 0) stages.push_back(stage);
+        }
+        std::sort(stages.begin(), stages.end(), [&trace](int a, int b) {
+            return trace.stamps_[a] < trace.stamps_[b];
+        });
+
+        // Each stage lasts until the next one, the last is an instant.
+        for (size_t index=0; index<stages.size(); index++) {
+            int64_t start = trace.stamps_[stages[index]];
+            ss << (first ? "" : ",")
+               << "{\"name\":\"" << comms_trace_stage_names[stages[index]] << "\""
+               << ",\"cat\":\"comms\""
+               << ",\"pid\":" << pid
+               << ",\"tid\":" << entry.first
+               << ",\"ts\":" << (start - origin_) / 1000.0;
+            if (index+1 < stages.size()) {
+                ss << ",\"ph\":\"X\",\"dur\":" << (trace.stamps_[stages[index+1]] - start) / 1000.0;
+            }
+            else {
+                ss << ",\"ph\":\"i\",\"s\":\"t\"";
+            }
+            ss << ",\"args\":{\"tag\":" << entry.first << ",\"lane\":" << trace.lane_ << "}}";
+            first = false;
+        }
+    }
+    ss << "]}";
+
+    return ss.str();
+}
+
+bool comms_t::trace_dump(const char *path) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (not out) return false;
+
+    out << tracer_.chrome_json(local_index_);
+    return static_cast<bool>(out);
+}
+
+int comms_trace_dump(comms_t *C,
+                     const char *path,
+                     char **error) {
+    if (not C->trace_dump(path)) {
+        std::stringstream ss;
+        ss << "Unable to write trace to " << path << ".";
+        comms_set_error(error, ss.str().c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -1,18 +1,35 @@
 #include <vector>
 #include <sstream>
 #include <thread>
+#include <algorithm>
+#include <iostream>
 
 extern "C" {
 #include "comms.h"
 }
 #include "comms_impl.h"
 
-comms_writer_t::comms_writer_t(comms_t *C)
+bool comms_retry_t::operator<(const comms_retry_t& other) const {
+    return due_ > other.due_;
+}
+
+static bool comms_retryable(int rc) {
+    return rc == COMMS_UNAVAILABLE
+        or rc == COMMS_DEADLINE_EXCEEDED
+        or rc == COMMS_RESOURCE_EXHAUSTED;
+}
+
+comms_writer_t::comms_writer_t(comms_t *C,
+                               size_t index)
         : C_(C)
+        , index_(index)
         , started_(false)
         , shutting_down_(false)
         , shutdown_(false)
-        , thread_(nullptr) {
+        , thread_(nullptr)
+        , rng_(std::random_device{}())
+        , stats_(C->create_stats_shard())
+        , rings_version_(0) {
 }
 
 void comms_writer_t::start(std::shared_ptr<comms_receiver_t> receiver) {
@@ -20,6 +37,7 @@ void comms_writer_t::start(std::shared_ptr<comms_receiver_t> receiver) {
 }
 
 void comms_writer_t::run(std::shared_ptr<comms_receiver_t> receiver) {
+    comms_pin_thread(C_->conf_.writer_cpus);
     receiver->wait_for_start();
 
     {
@@ -29,39 +47,126 @@ void comms_writer_t::run(std::shared_ptr<comms_receiver_t> receiver) {
         started_cv_.notify_all();
     }
 
-    const size_t retry_count = C_->conf_.writer_retry_count;
-    const size_t retry_delay = C_->conf_.writer_retry_delay;
+#ifdef COMMS_USE_TOKENS
+    moodycamel::ConsumerToken submit_token(*C_->submit_queue_);
+    moodycamel::ConsumerToken priority_token(*C_->priority_queue_);
+#endif
 
+    comms_bundle_t bundle;
+    std::unique_ptr<comms_bundle_t> unowned;
     while (true) {
-        // Grab a bundle.
-        comms_bundle_t bundle;
-        bool ok = C_->submit_queue_->try_dequeue(bundle);
+        // Past the drain deadline nothing more is sent.
+        if (C_->drain_expired()) break;
+
+        // Priority bundles go ahead of everything else, retries included.
+        if (resume_held(COMMS_WRITER_QUEUE_PRIORITY)) continue;
+        bool ok = false;
+        if (not held_[COMMS_WRITER_QUEUE_PRIORITY]) {
+#ifdef COMMS_USE_TOKENS
+            ok = C_->priority_queue_->try_dequeue(priority_token, bundle);
+#else
+            ok = C_->priority_queue_->try_dequeue(bundle);
+#endif
+        }
+        if (ok) {
+            if (bundle.trace_count_ > 0) {
+                C_->tracer_.stamp(bundle, COMMS_TRACE_WRITER_DEQUEUE);
+            }
+            dispatch_queued(COMMS_WRITER_QUEUE_PRIORITY, bundle);
+            continue;
+        }
+
+        // Retries whose backoff has elapsed go ahead of fresh bundles.
+        if (not retries_.empty() and retries_.front().due_ <= std::chrono::steady_clock::now()) {
+            std::pop_heap(retries_.begin(), retries_.end());
+            comms_retry_t retry = std::move(retries_.back());
+            retries_.pop_back();
+
+            // Retries were charged credit on their first attempt.
+            comms_bundle_t& bundle = *retry.bundle_;
+            dispatch(bundle, retry.bundle_, retry.attempt_, retry.rings_);
+            continue;
+        }
+
+        if (C_->skip_count_.load(std::memory_order_relaxed) > 0) {
+            take_skips();
+        }
+
+        if (C_->rings_version_.load(std::memory_order_acquire) != rings_version_) {
+            refresh_rings();
+        }
+
+        bool busy = resume_parked();
+        bool waiting = not retries_.empty() or not parked_.empty();
+
+        // Take one bundle from each assigned accessor ring in turn. Bundles
+        // are dispatched in place and the slot is freed afterwards, unless
+        // the bundle's lane has no credit.
+        for (auto& rings : rings_) {
+            comms_bundle_t *ring_bundle = rings->submit_.front();
+            if (ring_bundle == nullptr) continue;
+
+            if (ring_bundle->trace_count_ > 0) {
+                C_->tracer_.stamp(*ring_bundle, COMMS_TRACE_WRITER_DEQUEUE);
+            }
+            if (not dispatch(*ring_bundle, unowned, 0, rings)) {
+                waiting = true;
+                continue;
+            }
+            rings->submit_.pop();
+            busy = true;
+        }
+
+        // Grab a bundle from the shared queue.
+        if (resume_held(COMMS_WRITER_QUEUE_SUBMIT)) continue;
+        ok = false;
+        if (not held_[COMMS_WRITER_QUEUE_SUBMIT]) {
+#ifdef COMMS_USE_TOKENS
+            ok = C_->submit_queue_->try_dequeue(submit_token, bundle);
+#else
+            ok = C_->submit_queue_->try_dequeue(bundle);
+#endif
+        }
         if (not ok) {
-            if (shutting_down_) {
+            if (busy) continue;
+            // A drain also waits for the retries and the bundles waiting for
+            // credit to play out.
+            waiting = waiting or held_[COMMS_WRITER_QUEUE_PRIORITY] or held_[COMMS_WRITER_QUEUE_SUBMIT];
+            if (shutting_down_ and (not waiting or not C_->draining_)) {
                 break;
             }
+
+            // Let open circuit breakers probe their peers while idle.
+            for (auto& end_point : C_->end_points()) {
+                if (not end_point->removed()) end_point->probe();
+            }
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
             continue;
         }
 
-        // Transmit the packet bundle over the wire, then set the return code.
-        ok = C_->end_points_[0].transmit_n(bundle, retry_count, retry_delay);
-
-        comms_packet_t *packet_list = bundle.packet_list();
-        size_t num_packets = bundle.size();
-        for (size_t index=0; index<num_packets; index++) {
-            packet_list[index].reap.rc = ok ? 0 : 1;
-            static_cast<PacketQueue*>(packet_list[index].opaque)->try_enqueue(packet_list[index]);
+        if (bundle.trace_count_ > 0) {
+            C_->tracer_.stamp(bundle, COMMS_TRACE_WRITER_DEQUEUE);
         }
+        dispatch_queued(COMMS_WRITER_QUEUE_SUBMIT, bundle);
+    }
 
-        //// Deposit into the return queue only if the return queue is set.
-        //if (bundle.return_queue() != nullptr) {
-        //    // TODO: Probably shouldn't spin here, but alas.
-        //    while (not bundle.return_queue()->try_enqueue_bulk(packet_list, num_packets)) {
-        //        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        //    }
-        //}
+    // Bundles still backing off will not be retried, reap them with the code
+    // of their last failure, or as not drained when a drain ran out of time.
+    // Those still waiting for credit were never sent.
+    for (auto& retry : retries_) {
+        reap(*retry.bundle_, C_->draining_ ? COMMS_NOT_DRAINED : retry.rc_, retry.rings_);
+    }
+    retries_.clear();
+    int rc = C_->draining_ ? COMMS_NOT_DRAINED : COMMS_NOT_SCHEDULED;
+    for (auto& entry : parked_) {
+        reap(*entry.second, rc, nullptr);
+    }
+    parked_.clear();
+    for (auto& held : held_) {
+        if (held) reap(*held, rc, nullptr);
+        held = nullptr;
     }
+    reap_undrained(false);
 
     // Acquire shutdown mutex and notify shutdown.
     std::unique_lock<std::mutex> lck(shutdown_mtx_);
@@ -69,6 +174,244 @@ void comms_writer_t::run(std::shared_ptr<comms_receiver_t> receiver) {
     shutdown_cv_.notify_all();
 }
 
+// rings are those of the accessor a ring bundle came from, null otherwise.
+// Returns false, leaving the bundle with the caller, while its lane has no
+// credit; owned is moved from only when the bundle is deferred.
+bool comms_writer_t::dispatch(comms_bundle_t& bundle,
+                              std::unique_ptr<comms_bundle_t>& owned,
+                              size_t attempt,
+                              const std::shared_ptr<comms_accessor_rings_t>& rings) {
+    EndPoint& end_point = *C_->end_points()[bundle.dst()];
+    const size_t deadline = C_->conf_.writer_rpc_deadline;
+
+    // Fail fast once the destination has left the membership, while its
+    // circuit breaker is open, or while it is half open and another bundle
+    // is the trial.
+    if (end_point.removed()) {
+        reap(bundle, COMMS_PEER_REMOVED, rings);
+        return true;
+    }
+    bool trial = false;
+    if (not end_point.available(trial)) {
+        // A skip waits for the peer to come back instead.
+        if (bundle.size() == 0 and attempt < retry_count(bundle)) {
+            defer(bundle, std::move(owned), attempt+1, COMMS_PEER_UNAVAILABLE, backoff(attempt+1), rings);
+            return true;
+        }
+        reap(bundle, COMMS_PEER_UNAVAILABLE, rings);
+        return true;
+    }
+
+    // The bundle waits with the caller until the receiver grants credit on
+    // its lane. Credit is charged once per bundle and kept across retries.
+    if (not bundle.charged_ and bundle.size() > 0) {
+        if (not end_point.acquire_credit(bundle.lane())) {
+            // The trial goes to whichever bundle is sent next.
+            if (trial) end_point.end_trial();
+            end_point.poll_credit(bundle.lane(), deadline);
+            return false;
+        }
+        bundle.charged_ = true;
+    }
+
+    // Transmit the packet bundle over the wire. A retryable failure puts
+    // the bundle aside so that other destinations are not held up while
+    // this one backs off.
+    if (bundle.trace_count_ > 0) {
+        C_->tracer_.stamp(bundle, COMMS_TRACE_RPC_START);
+    }
+    int64_t start = comms_now_ns();
+    int rc = end_point.transmit_n(bundle, deadline);
+    stats_->transmit_latency_.record((comms_now_ns() - start) / 1000);
+    if (bundle.trace_count_ > 0) {
+        C_->tracer_.stamp(bundle, COMMS_TRACE_RPC_FINISH);
+    }
+
+    if (comms_retryable(rc) and attempt < retry_count(bundle)) {
+        stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_RETRIED_PACKETS, bundle.size());
+        defer(bundle, std::move(owned), attempt+1, rc, backoff(attempt+1), rings);
+    }
+    else {
+        reap(bundle, rc, rings);
+    }
+    return true;
+}
+
+static std::pair<uint32_t,uint32_t> comms_writer_lane(const comms_bundle_t& bundle) {
+    return std::make_pair(bundle.dst(), bundle.lane());
+}
+
+// A bundle taken from a shared queue. If its lane already has a parked
+// bundle it is held, which stops further takes from the queue.
+void comms_writer_t::dispatch_queued(int queue,
+                                     comms_bundle_t& bundle) {
+    if (parked_.count(comms_writer_lane(bundle)) > 0) {
+        held_[queue].reset(new comms_bundle_t(bundle));
+        return;
+    }
+    std::unique_ptr<comms_bundle_t> unowned;
+    if (not dispatch(bundle, unowned, 0, nullptr)) {
+        parked_[comms_writer_lane(bundle)].reset(new comms_bundle_t(bundle));
+    }
+}
+
+// Dispatches the parked bundles whose lanes have credit again. Returns
+// whether any left.
+bool comms_writer_t::resume_parked() {
+    bool resumed = false;
+    for (auto it=parked_.begin(); it!=parked_.end(); ) {
+        if (dispatch(*it->second, it->second, 0, nullptr)) {
+            it = parked_.erase(it);
+            resumed = true;
+        }
+        else {
+            ++it;
+        }
+    }
+    return resumed;
+}
+
+// Dispatches the bundle held for a queue once its lane's parked bundle has
+// left. Returns whether it did.
+bool comms_writer_t::resume_held(int queue) {
+    std::unique_ptr<comms_bundle_t>& held = held_[queue];
+    if (not held or parked_.count(comms_writer_lane(*held)) > 0) return false;
+
+    std::unique_ptr<comms_bundle_t> owned = std::move(held);
+    comms_bundle_t& bundle = *owned;
+    if (not dispatch(bundle, owned, 0, nullptr)) {
+        parked_[comms_writer_lane(bundle)] = std::move(owned);
+    }
+    return true;
+}
+
+void comms_writer_t::refresh_rings() {
+    std::unique_lock<std::mutex> lck(C_->stats_mtx_);
+    rings_version_ = C_->rings_version_.load(std::memory_order_acquire);
+
+    rings_.clear();
+    for (auto& rings : C_->rings_) {
+        if (rings->writer_ == index_) rings_.push_back(rings);
+    }
+}
+
+size_t comms_writer_t::backoff(size_t attempt) {
+    // Exponential backoff capped at the maximum delay, with jitter over the
+    // upper half of the interval so that writers don't retry in lockstep.
+    const size_t base_delay = C_->conf_.writer_retry_delay;
+    const size_t max_delay = C_->conf_.writer_retry_max_delay;
+    size_t delay = base_delay;
+    for (size_t index=1; index<attempt and delay < max_delay; index++) {
+        delay *= 2;
+    }
+    delay = std::min(delay, max_delay);
+    std::uniform_int_distribution<size_t> jitter(delay/2, delay);
+    return jitter(rng_);
+}
+
+// Empty bundles on the way here are skips.
+size_t comms_writer_t::retry_count(const comms_bundle_t& bundle) const {
+    const size_t count = C_->conf_.writer_retry_count;
+    return bundle.size() == 0 ? std::max(count, size_t(COMMS_SKIP_RETRY_COUNT)) : count;
+}
+
+void comms_writer_t::defer(comms_bundle_t& bundle,
+                           std::unique_ptr<comms_bundle_t> owned,
+                           size_t attempt,
+                           int rc,
+                           size_t delay,
+                           const std::shared_ptr<comms_accessor_rings_t>& rings) {
+    comms_retry_t retry;
+    retry.due_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay);
+    retry.attempt_ = attempt;
+    retry.rc_ = rc;
+    retry.bundle_ = owned ? std::move(owned) : std::unique_ptr<comms_bundle_t>(new comms_bundle_t(bundle));
+    retry.rings_ = rings;
+    retries_.push_back(std::move(retry));
+    std::push_heap(retries_.begin(), retries_.end());
+}
+
+void comms_writer_t::reap(comms_bundle_t& bundle,
+                          int rc,
+                          const std::shared_ptr<comms_accessor_rings_t>& rings) {
+    EndPoint& end_point = *C_->end_points()[bundle.dst()];
+
+    // A duplicate means an earlier attempt got through after all.
+    bool delivered = rc == COMMS_SUCCESS or rc == COMMS_DUPLICATE;
+    if (rc == COMMS_NOT_DRAINED) {
+        if (bundle.broadcast_ == nullptr or not bundle.broadcast_->undrained_.exchange(true)) {
+            C_->undrained_packets_ += bundle.size();
+        }
+    }
+    else if (not delivered and rc != COMMS_PEER_UNAVAILABLE and rc != COMMS_PEER_REMOVED) {
+        std::cerr << "[" << end_point.name() << "] RPC failed: reap code "
+                  << rc << std::endl;
+    }
+
+    // Credit for a bundle that never made it is returned to the pool, and
+    // its sequence number skipped so that the ones after it are not held up.
+    if (not delivered and bundle.charged_) {
+        end_point.refund_credit(bundle.lane());
+    }
+    if (not delivered and bundle.size() > 0 and rc != COMMS_PEER_REMOVED and rc != COMMS_NOT_DRAINED) {
+        C_->skip(bundle);
+    }
+
+    size_t packet_count = bundle.size();
+    if (packet_count > 0) {
+        if (delivered) {
+            stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_TRANSMITTED_PACKETS, packet_count);
+            stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_TRANSMITTED_BYTES, bundle.bytes_);
+        }
+        else {
+            stats_->add(bundle.dst(), bundle.lane(), COMMS_COUNTER_FAILED_PACKETS, packet_count);
+        }
+        stats_->reap_latency_.record((comms_now_ns() - bundle.opened_at_) / 1000, packet_count);
+    }
+
+    // Bundles from an accessor ring are reaped through its reap ring, with
+    // any overflow going to the accessor's reap queue.
+    bundle.reap(rc, rings ? &rings->reap_ : nullptr);
+}
+
+// Reaps what is left in this writer's rings or, with shared_queues, in the
+// queues all writers take from, which only the last one to stop may do.
+void comms_writer_t::reap_undrained(bool shared_queues) {
+    comms_bundle_t bundle;
+    if (shared_queues) {
+        while (C_->priority_queue_->try_dequeue(bundle)) {
+            reap(bundle, COMMS_NOT_DRAINED, nullptr);
+        }
+        while (C_->submit_queue_->try_dequeue(bundle)) {
+            reap(bundle, COMMS_NOT_DRAINED, nullptr);
+        }
+        return;
+    }
+
+    refresh_rings();
+    for (auto& rings : rings_) {
+        while (comms_bundle_t *ring_bundle = rings->submit_.front()) {
+            reap(*ring_bundle, COMMS_NOT_DRAINED, rings);
+            rings->submit_.pop();
+        }
+    }
+}
+
+// Turns the sequence numbers given up on into empty bundles, sent like
+// retries that are due now.
+void comms_writer_t::take_skips() {
+    std::vector<comms_skip_t> skips;
+    C_->take_skips(skips);
+    for (const comms_skip_t& skip : skips) {
+        std::unique_ptr<comms_bundle_t> owned(new comms_bundle_t());
+        comms_bundle_t& bundle = *owned;
+        bundle.dst_ = skip.dst_;
+        bundle.lane_ = skip.lane_;
+        bundle.sequence_ = skip.sequence_;
+        defer(bundle, std::move(owned), 0, COMMS_NOT_SCHEDULED, 0, nullptr);
+    }
+}
+
 void comms_writer_t::shutdown() {
     shutting_down_ = true;
 }
@@ -96,6 +96,16 @@ int main(int argc, char **argv) {
     COMMS_HANDLE_ERROR(rc, error);
     rc = comms_configure(C, "arena-start-block-depth", "20", &error);
     COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_configure(C, "channels-per-end-point", "2", &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_configure(C, "channel-policy", "least-loaded", &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_configure(C, "max-send-message-size", "67108864", &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_configure(C, "max-receive-message-size", "67108864", &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    rc = comms_configure(C, "http2-initial-window-size", "8388608", &error);
+    COMMS_HANDLE_ERROR(rc, error);
 
     // Launch catch/release thread.
     std::thread catch_and_release(catch_and_release_thread, C);
@@ -138,7 +148,9 @@ int main(int argc, char **argv) {
             // Generate a random payload and assign it to the packet.
             std::vector<uint8_t> data(COMMS_PAYLOAD_SIZE);
             std::generate(begin(data), end(data), std::ref(rbe));
-            uint8_t *payload = (uint8_t*)calloc(COMMS_PAYLOAD_SIZE, sizeof(uint8_t));
+            uint8_t *payload = NULL;
+            rc = comms_payload_alloc(A, COMMS_PAYLOAD_SIZE, 0, &payload, &error);
+            COMMS_HANDLE_ERROR(rc, error);
             payloads.push_back(payload);
             memcpy(payload, data.data(), sizeof(uint8_t)*COMMS_PAYLOAD_SIZE);
             packet_list[index].payload = payload;
@@ -169,7 +181,7 @@ int main(int argc, char **argv) {
         total_reaped += num_reaped;
 
         for (size_t index=0; index<num_reaped; index++) {
-            if (packet_list[index].reap.rc == COMMS_SUCCESS) {
+            if (packet_list[index].reap.rc == COMMS_SUCCESS or packet_list[index].reap.rc == COMMS_DUPLICATE) {
                 total_successful++;
             }
 
@@ -213,6 +225,14 @@ int main(int argc, char **argv) {
     // Verify all submitted packets were reaped.
     assert( total_submitted == total_reaped );
 
+    // Report the comms layer's view of the run.
+    comms_stats_t stats;
+    rc = comms_stats(C, -1, -1, &stats, &error);
+    COMMS_HANDLE_ERROR(rc, error);
+    printf("transmitted: %8lu, retried: %lu, failed: %lu, reap p50/p99/max: %lu/%lu/%lu us\n",
+           stats.transmitted_packets, stats.retried_packets, stats.failed_packets,
+           stats.reap_latency_p50_us, stats.reap_latency_p99_us, stats.reap_latency_max_us);
+
     // Shut down the comms layer.
     comms_shutdown(C, &error);
 
@@ -225,7 +245,8 @@ int main(int argc, char **argv) {
 
     // Free all payloads.
     for (uint8_t *payload : payloads) {
-        free(payload);
+        rc = comms_payload_free(A, payload, &error);
+        COMMS_HANDLE_ERROR(rc, error);
     }
 
     // Destroy accessor.